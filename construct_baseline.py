@@ -46,6 +46,7 @@ def read_multi_layer_EOG(filename):
     edge_map = {}
     reverse_edge_map = {}
     edge_labels = {}
+    layer_bits = {}
     
     edge_sim = {}
     edge_link = {}
@@ -60,17 +61,17 @@ def read_multi_layer_EOG(filename):
             n1, n2 = int(chars[1]), int(chars[2])                  
             e1 = (n1, n2) if n1 < n2 else (n2, n1)            
             if e1 not in edge_map:
-                edge_labels[e1] = set()
+                edge_labels[e1] = 0
                 edge_map[e1] = count
                 reverse_edge_map[count] = e1
                 count += 1
-            edge_labels[e1].add(layer)                
+            edge_labels[e1] |= layer_bits.setdefault(layer, 1 << len(layer_bits))                
 
     edges = list(edge_map.keys())
     for in1 in range(len(edges)):
         for ie2 in range(in1+1, len(edges)):
             e1, e2 = edges[in1], edges[ie2]
-            js = len(edge_labels[e1] & edge_labels[e2])/len(edge_labels[e1] | edge_labels[e2])
+            js = bin(edge_labels[e1] & edge_labels[e2]).count('1')/bin(edge_labels[e1] | edge_labels[e2]).count('1')
             if js > 0:
                 pair = (e1, e2) if e1 < e2 else (e2, e1)
                 edge_sim[pair] = js
@@ -95,6 +96,7 @@ def read_multi_layer_NOG(filename):
     node_link_deg = {}    
     
     node_labels = {}  
+    layer_bits = {}
    
     count = 1 
     with open(filename) as file:
@@ -104,26 +106,26 @@ def read_multi_layer_NOG(filename):
             n1, n2 = int(chars[1]), int(chars[2])            
             
             if n1 not in node_map:
-                node_labels[n1] = set()
+                node_labels[n1] = 0
                 node_map[n1] = count
                 reverse_node_map[count] = n1
                 count += 1
             if n2 not in node_map:
-                node_labels[n2] = set()
+                node_labels[n2] = 0
                 node_map[n2] = count
                 reverse_node_map[count] = n2
                 count += 1
             pair = (n1, n2) if n1 < n2 else (n2, n1)
             node_link[pair] = 1
-            node_labels[n1].add(layer)
-            node_labels[n2].add(layer)
+            node_labels[n1] |= layer_bits.setdefault(layer, 1 << len(layer_bits))
+            node_labels[n2] |= layer_bits.setdefault(layer, 1 << len(layer_bits))
                 
     nodes = list(node_map.keys())
     for in1 in range(len(nodes)):
         for in2 in range(in1+1, len(nodes)):
             n1, n2 = nodes[in1], nodes[in2]
             pair = (n1, n2) if n1 < n2 else (n2, n1)
-            js = len(node_labels[n1] & node_labels[n2])/len(node_labels[n1] | node_labels[n2])
+            js = bin(node_labels[n1] & node_labels[n2]).count('1')/bin(node_labels[n1] | node_labels[n2]).count('1')
             if js > 0:                
                 node_sim[pair] = js
                 node_sim_deg[n1] = node_sim_deg.get(n1, 0) + js
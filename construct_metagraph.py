@@ -7,6 +7,8 @@ from ctypes import cdll, c_double, c_int, byref
 import sys
 import os
 import pickle
+import struct
+from array import array
 
 import argparse
     
@@ -39,13 +41,51 @@ def write_graph_file(G, s, t, filename = 'test_graph.txt'):
         file.write('a ' + str(u) + ' ' + str(v) + ' ' + str(G[u][v]['cap']) + '\n')
     file.close() 
     
+
+METAGRAPH_MAGIC = b'DSMGRAPH'
+METAGRAPH_VERSION = 1
+METAGRAPH_HEADER = struct.Struct('=8sii6q')
+
+def write_binary_metagraph(num_nodes, s, t, tails, heads, caps, filename, num_edges = 0):
+    # layout documented in src/1.0/metagraph.h: header, CSR offsets, tails, heads, capacities
+    order = sorted(range(len(tails)), key = lambda i: tails[i])
+    first = array('q', [0]*(num_nodes + 1))
+    for u in tails:
+        first[u] += 1
+    for i in range(num_nodes):
+        first[i+1] += first[i]
+    with open(filename, 'wb') as file:
+        file.write(METAGRAPH_HEADER.pack(METAGRAPH_MAGIC, METAGRAPH_VERSION, METAGRAPH_HEADER.size, num_nodes, len(tails), s, t, num_edges, 0))
+        first.tofile(file)
+        array('i', (tails[i] for i in order)).tofile(file)
+        array('i', (heads[i] for i in order)).tofile(file)
+        array('d', (caps[i] for i in order)).tofile(file)
+
+def write_binary_graph_file(G, s, t, num_edges, filename = 'test_graph.bin'):
+    tails, heads, caps = [], [], []
+    for u,v in G.edges():
+        tails.append(u)
+        heads.append(v)
+        caps.append(G[u][v]['cap'])
+    write_binary_metagraph(G.number_of_nodes(), s, t, tails, heads, caps, filename, num_edges)
+    
     
-def read_multi_layer(filename):
+def sparsify_topk(pairs, topk):
+    # keep a pair if it is among the topk partners of either edge, ranked by similarity then id
+    ranked = {}
+    for ie1, ie2, js in pairs:
+        ranked.setdefault(ie1, []).append((-js, ie2))
+        ranked.setdefault(ie2, []).append((-js, ie1))
+    best = {ie: set(partner for _, partner in sorted(r)[:topk]) for ie, r in ranked.items()}
+    return [(ie1, ie2, js) for ie1, ie2, js in pairs if ie2 in best[ie1] or ie1 in best[ie2]]
+
+def read_multi_layer(filename, threshold = 0.0, topk = 0):
     edge_map = {}
     node_map = {}
     reverse_edge_map = {}
     reverse_node_map = {}
     edge_labels = {}
+    layer_bits = {}
     
     sum = {}
     stddev = {}
@@ -62,35 +102,52 @@ def read_multi_layer(filename):
             n1, n2 = int(chars[1]), int(chars[2])            
             e1 = (n1, n2) if n1 < n2 else (n2, n1)            
             if e1 not in edge_map:
-                edge_labels[e1] = set()
+                edge_labels[e1] = 0
                 edge_map[e1] = count
                 reverse_edge_map[count] = e1
                 count += 1
                 node_map[e1[0]] = -1
                 node_map[e1[1]] = -1
-            edge_labels[e1].add(layer)
+            edge_labels[e1] |= layer_bits.setdefault(layer, 1 << len(layer_bits))
                 
     for u in node_map:
         node_map[u] = count
         count += 1
                 
     edges = list(edge_map.keys())
+    pairs = []
+    num_similar, total_similar = 0, 0.0
     for ie1 in range(len(edges)):
         for ie2 in range(ie1+1, len(edges)):
             e1, e2 = edges[ie1], edges[ie2]
-            js = len(edge_labels[e1] & edge_labels[e2])/len(edge_labels[e1] | edge_labels[e2])
+            js = bin(edge_labels[e1] & edge_labels[e2]).count('1')/bin(edge_labels[e1] | edge_labels[e2]).count('1')
             if js > 0:
-                pair = (e1, e2) if e1 < e2 else (e2, e1)
-                sim[pair] = js
-                simdegree[e1] = simdegree.get(e1, 0) + js
-                simdegree[e2] = simdegree.get(e2, 0) + js
+                num_similar += 1
+                total_similar += js
+                if js >= threshold:
+                    pairs.append((ie1, ie2, js))
+    if topk > 0:
+        pairs = sparsify_topk(pairs, topk)
+        
+    kept_similar = 0.0
+    for ie1, ie2, js in pairs:
+        e1, e2 = edges[ie1], edges[ie2]
+        pair = (e1, e2) if e1 < e2 else (e2, e1)
+        sim[pair] = js
+        simdegree[e1] = simdegree.get(e1, 0) + js
+        simdegree[e2] = simdegree.get(e2, 0) + js
+        kept_similar += js
+        
+    if threshold > 0 or topk > 0:
+        discarded = total_similar - kept_similar
+        print('sparsification kept %d of %d similar pairs, discarded similarity %g of %g (%.2f%%)' % (len(pairs), num_similar, discarded, total_similar, 100*discarded/total_similar if total_similar > 0 else 0.0))
                 
     return sim, simdegree, edge_map, node_map, reverse_edge_map
     
     
-def write_metagraph(filename, indir='Data', outdir='Data'):
+def write_metagraph(filename, indir='Data', outdir='Data', threshold = 0.0, topk = 0):
     print('read input file')
-    sim, simdegree, edge_map, node_map, reverse_edge_map = read_multi_layer(os.path.join('.', indir, filename + '.edges'))
+    sim, simdegree, edge_map, node_map, reverse_edge_map = read_multi_layer(os.path.join('.', indir, filename + '.edges'), threshold, topk)
         
     lmbda = 0.0
     print('construct metagraph')
@@ -98,6 +155,7 @@ def write_metagraph(filename, indir='Data', outdir='Data'):
     filename_meta = 'metagraph_' + filename + '.txt'
     print('write metagraph')
     write_graph_file(H, src, sink, os.path.join('.', 'Data', filename_meta))
+    write_binary_graph_file(H, src, sink, len(edge_map), os.path.join('.', 'Data', 'metagraph_' + filename + '.bin'))
     filename_pickle = 'metagraph_' + filename + '.p'
     pickle.dump((sim, simdegree, edge_map, node_map, reverse_edge_map), open( os.path.join('.', outdir, filename_pickle), "wb" ))
     
@@ -109,5 +167,8 @@ if __name__ == "__main__":
     parser.add_argument('--indir', '-i', type=str, default='Data', help='input data folder')
     parser.add_argument('--outdir', '-o', type=str, default='Data', help='output data folder')
     
+    parser.add_argument('--threshold', '-j', type=float, default=0.0, help='keep only similar pairs with Jaccard at least this value')
+    parser.add_argument('--topk', '-n', type=int, default=0, help='keep only the k most similar partners of each edge (0 keeps all)')
+    
     args = parser.parse_args()
-    write_metagraph(args.dataset, args.indir, args.outdir)
\ No newline at end of file
+    write_metagraph(args.dataset, args.indir, args.outdir, args.threshold, args.topk)
\ No newline at end of file
@@ -0,0 +1,41 @@
+import os
+import sys
+
+import argparse
+
+from construct_metagraph import write_binary_metagraph
+
+
+def convert_metagraph(txtname, binname):
+    tails, heads, caps = [], [], []
+    num_nodes, s, t = 0, 0, 0
+    with open(txtname) as file:
+        for line in file:
+            chars = line.split()
+            if not chars:
+                continue
+            if chars[0] == 'a':
+                tails.append(int(chars[1]))
+                heads.append(int(chars[2]))
+                caps.append(float(chars[3]))
+            elif chars[0] == 'n':
+                if chars[2] == 's':
+                    s = int(chars[1])
+                elif chars[2] == 't':
+                    t = int(chars[1])
+            elif chars[0] == 'p':
+                num_nodes = int(chars[2])
+    num_edges = sum(1 for u, v in zip(tails, heads) if v == t and u != s)
+    write_binary_metagraph(num_nodes, s, t, tails, heads, caps, binname, num_edges)
+    print('converted', txtname, '->', binname, ':', num_nodes, 'nodes,', len(tails), 'arcs')
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter, description='Convert a DIMACS metagraph_*.txt file into the binary metagraph format')
+    parser.add_argument('--dataset', '-d', type=str, default='CS-Aarhus_multiplex', help='dataset filename (options: CS-Aarhus_multiplex)')
+    parser.add_argument('--indir', '-i', type=str, default='Data', help='data folder of a metagraph')
+    
+    args = parser.parse_args()
+    name = os.path.join('.', args.indir, 'metagraph_' + args.dataset)
+    convert_metagraph(name + '.txt', name + '.bin')
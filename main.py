@@ -3,7 +3,7 @@ from networkx.generators.random_graphs import *
 import random
 import numpy as np
 import matplotlib.pyplot as plt
-from ctypes import cdll, c_double, c_int, byref
+from ctypes import cdll, c_double, c_int, c_longlong, c_void_p, byref
 import sys
 import os
 import pickle
@@ -18,15 +18,11 @@ ALLOWED_ERROR = 1e-10
 ALLOWED_DIFFERENCE = 1e-5
 
                     
-def print_edgeset(reverse_edge_map, srcSet):
-    num_edges = len(reverse_edge_map)
-    count = 0
+def print_edgeset(reverse_edge_map, edges):
     print('Edgelist: ', end='')
-    for i in range(len(srcSet)):
-        if srcSet[i] == 1:
-            print(reverse_edge_map[i+1], end=' ')
-            count+=1
-    print('\nSize:', count)
+    for i in edges:
+        print(reverse_edge_map[i+1], end=' ')
+    print('\nSize:', len(edges))
 
 def lambda_search(l_max, l_min, l_delta, max_iters, reverse_edge_map, printedeges=False):
     P = []
@@ -78,53 +74,70 @@ def lambda_search(l_max, l_min, l_delta, max_iters, reverse_edge_map, printedege
     print('Lambda-search stats:', iterations, 'iterations', total_time_search)
     print('iterations:', iterations, '; total time:', total_time_search)
 
+
+def lambda_search_parallel(l_max, l_min, l_delta, max_iters, reverse_edge_map, num_threads, printedeges=False):
+    iterations = c_longlong()
+    t1 = time.time()
+    num_solutions = lib.c_lambdaSearch(ps, c_int(num_edges), c_double(total_sim), c_double(l_min), c_double(l_max),
+                                       c_double(l_delta), c_double(max_iters), c_int(num_threads),
+                                       c_double(ALLOWED_ERROR), c_double(ALLOWED_DIFFERENCE), byref(iterations))
+    total_time_search = time.time() - t1
+    l, sim, den, size = c_double(), c_double(), c_double(), c_int()
+    for i in range(num_solutions):
+        lib.c_getLambdaSolution(ps, c_int(i), byref(l), byref(sim), byref(den), byref(size))
+        print('New solution found:')
+        print('lambda: {:10}, similarity: {:10}, density: {:10}'.format(l.value, sim.value, den.value))
+        if printedeges:
+            count = lib.c_getLambdaSolutionEdgeList(ps, c_int(i), byref(srcSet))
+            print_edgeset(reverse_edge_map, srcSet[:count])
+    sys.stdout.flush()
+    print('Lambda-search stats:', iterations.value, 'iterations', total_time_search)
+    print('iterations:', iterations.value, '; total time:', total_time_search)
+
+
+def parametric_breakpoints(lambdas, c, reverse_edge_map, printedeges=False):
+    num_total = lib.c_getNumNodes(ps)
+    breakpoints = (c_double*num_total)()
+    t1 = time.time()
+    if lib.c_parametricCut(ps, c_double(c), (c_double*len(lambdas))(*lambdas), c_int(len(lambdas)), byref(breakpoints)) != 0:
+        return None
+    total_time = time.time() - t1
+    leaving = {}
+    for i in range(num_edges):
+        if breakpoints[i] < INFINITY_NUMBER:
+            leaving.setdefault(breakpoints[i], []).append(i)
+    for l in lambdas:
+        if l in leaving:
+            print('lambda: {:10}, edges leaving: {:10}'.format(l, len(leaving[l])))
+            if printedeges:
+                print('Edgelist:', ' '.join(str(reverse_edge_map[i+1]) for i in leaving[l]))
+            del leaving[l]
+    print('Parametric cut stats:', len(lambdas), 'lambdas', total_time)
+    return breakpoints
+
     
+def load_metagraph_maps(filename):
+    # id maps written by densim-build, see src/1.0/densim_build.c
+    total_sim, edge_map, node_map, reverse_edge_map = 0, {}, {}, {}
+    with open(filename) as file:
+        for line in file:
+            chars = line.split()
+            if chars[0] == 't':
+                total_sim = float(chars[1])
+            elif chars[0] == 'e':
+                e = (int(chars[2]), int(chars[3]))
+                edge_map[e] = int(chars[1])
+                reverse_edge_map[int(chars[1])] = e
+            elif chars[0] == 'v':
+                node_map[int(chars[2])] = int(chars[1])
+    return total_sim, edge_map, node_map, reverse_edge_map
+
 def solve_MinCut(lmbda, precision = ALLOWED_ERROR, max_iters = 1000):   
     #print('Lambda:', lmbda)
-    c = -lmbda*num_nodes
-    lib.c_reCreateGraph(c_int(num_edges), c_double(lmbda), c_double(c))
-    
-    counter = 0
-    srcSet_odd = (c_int*num_edges)()
-    srcSet_even = (c_int*num_edges)()
-    cur_sim, cur_den = -1, -1
-    old_sim, old_den = -10, -10
-    total_time = 0
-    while counter < max_iters:
-        ts = time.time()
-        lib.c_pseudoflowPhase1()
-        mincut_c = lib.c_getMinCutValue()       
-                
-        F_edges = c_int()
-        F_nodes = c_int()
-        lib.c_getSizeOfMinCutSet(c_int(num_edges), byref(F_edges), byref(F_nodes))
-                
-        if counter%2 == 0:           
-            lib.c_getMinCutEdgeSet(c_int(num_edges), byref(srcSet_even))
-        else:           
-            lib.c_getMinCutEdgeSet(c_int(num_edges), byref(srcSet_odd))
-        
-        Q = -mincut_c + .5*total_sim
-
-        if (Q < precision) or (F_edges.value == 0) or counter == max_iters-1:
-            if  counter%2 == 0:
-                total_time += time.time() - ts
-                #print('Q-iterations:', counter, total_time)
-                return cur_sim, cur_den, srcSet_odd
-            else:
-                total_time += time.time() - ts
-                #print('Q-iterations:', counter, total_time)
-                return cur_sim, cur_den, srcSet_even
-            break         
-     
-        newc_c = Q/F_edges.value + c
-        cur_sim, cur_den = c + (Q + lmbda*F_nodes.value)/F_edges.value, F_edges.value/F_nodes.value
-        
-        lib.c_updateSrcCapacities(c_double(newc_c), c_int(num_edges))
-        
-        c = newc_c 
-        counter += 1
-        total_time += time.time() - ts
+    lib.c_solveRatio(ps, c_double(lmbda), c_double(total_sim), c_double(precision), c_int(max_iters), None, byref(solve_stats))
+    #print('Q-iterations:', solve_stats[2])
+    size = lib.c_getRatioEdgeList(ps, byref(srcSet))
+    return solve_stats[0], solve_stats[1], srcSet[:size]
 
     
 if __name__ == "__main__":
@@ -133,22 +146,44 @@ if __name__ == "__main__":
     parser.add_argument('--dataset', '-d', type=str, default='CS-Aarhus_multiplex', help='dataset filename (options: CS-Aarhus_multiplex)')
     parser.add_argument('--indir', '-i', type=str, default='Data', help='data folder of a metagraph')
     parser.add_argument('--printedeges', '-p', action='store_true', help='print solutions edgesets')
+    parser.add_argument('--threads', '-t', type=int, default=1, help='number of threads for the lambda search (1 runs the serial search)')
+    parser.add_argument('--breakpoints', '-b', type=str, default='', help='instead of the lambda search, report edge breakpoints in one parametric run over N lambdas evenly spaced in [0, 1e6], or over a comma-separated non-decreasing list; breakpoints are only resolved to that grid')
+    parser.add_argument('--edgecost', '-c', type=float, default=0.0, help='source capacity of the edge-vertices for --breakpoints')
+    parser.add_argument('--globalrelabel', '-g', type=float, default=0.0, help='run a global relabel whenever the arc scans and relabels since the last one exceed the graph size divided by this value (0 disables it)')
+    parser.add_argument('--capacityscale', '-s', type=float, default=1048576.0, help='units per 1 of the capacities when the library is built with -DFIXED_POINT (ignored otherwise)')
+    parser.add_argument('--renumber', '-r', action='store_true', help='lay the metagraph nodes out in breadth-first order inside the solver (results keep the file numbering)')
     
     args = parser.parse_args()
     filename = args.dataset
     
-    sim, simdegree, edge_map, node_map, reverse_edge_map = pickle.load(open(os.path.join('.', args.indir, 'metagraph_' + filename + '.p'), "rb" ))
+    picklename = os.path.join('.', args.indir, 'metagraph_' + filename + '.p')
+    if os.path.exists(picklename):
+        sim, simdegree, edge_map, node_map, reverse_edge_map = pickle.load(open(picklename, "rb" ))
+        total_sim = sum(simdegree.values())
+    else:
+        total_sim, edge_map, node_map, reverse_edge_map = load_metagraph_maps(os.path.join('.', args.indir, 'metagraph_' + filename + '.maps'))
     
     max_num_lambdas = INFINITY_NUMBER
    
-    total_sim = sum(simdegree.values())
     num_edges = len(edge_map)
     num_nodes = len(node_map)
     
     lib = cdll.LoadLibrary('./bin/lib_pseudopar.so')
-    filename = 'metagraph_' + filename + '.txt'
-    lib.c_readDimacsFileCreateList(bytes(os.path.join('.', args.indir, filename), "utf8"))
-    lib.c_simpleInitialization()
+    lib.ps_create.restype = c_void_p
+    ps = c_void_p(lib.ps_create())
+    lib.c_setCapacityScale(ps, c_double(args.capacityscale))
+    lib.c_setRenumbering(ps, c_int(args.renumber))
+    binname = os.path.join('.', args.indir, 'metagraph_' + filename + '.bin')
+    txtname = os.path.join('.', args.indir, 'metagraph_' + filename + '.txt')
+    # a .bin left behind by an earlier build must not shadow a newer .txt
+    if os.path.exists(binname) and (not os.path.exists(txtname) or os.path.getmtime(binname) >= os.path.getmtime(txtname)):
+        lib.c_readBinaryFileCreateList(ps, bytes(binname, "utf8"))
+    else:
+        lib.c_readDimacsFileCreateList(ps, bytes(txtname, "utf8"))
+    lib.c_setGlobalRelabel(ps, c_double(args.globalrelabel))
+    lib.c_simpleInitialization(ps)
+    srcSet = (c_int*num_edges)()
+    solve_stats = (c_double*4)()
     mincut_func = lib.c_getMinCutValue
     mincut_func.restype = c_double
     srcSetSize_func = lib.c_getSizeOfMinCutSet
@@ -156,7 +191,18 @@ if __name__ == "__main__":
     
     ds = 0.001
     l_delta = ds/(num_edges*num_edges)
-    lambda_search(l_max = 1000000, l_min = 0, l_delta = l_delta, max_iters = max_num_lambdas, reverse_edge_map = reverse_edge_map)
+    lambdas = []
+    if ',' in args.breakpoints:
+        lambdas = [float(l) for l in args.breakpoints.split(',') if l]
+    elif args.breakpoints:
+        n = int(args.breakpoints)
+        lambdas = [1000000*(i/(n-1) if n > 1 else 0) for i in range(n)]
+    if lambdas:
+        parametric_breakpoints(lambdas, args.edgecost, reverse_edge_map, printedeges = args.printedeges)
+    elif args.threads > 1:
+        lambda_search_parallel(l_max = 1000000, l_min = 0, l_delta = l_delta, max_iters = max_num_lambdas, reverse_edge_map = reverse_edge_map, num_threads = args.threads, printedeges = args.printedeges)
+    else:
+        lambda_search(l_max = 1000000, l_min = 0, l_delta = l_delta, max_iters = max_num_lambdas, reverse_edge_map = reverse_edge_map, printedeges = args.printedeges)
     
     
-    lib.c_finalfreeMemory()
\ No newline at end of file
+    lib.ps_destroy(ps)
\ No newline at end of file
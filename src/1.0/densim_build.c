@@ -0,0 +1,1758 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <immintrin.h>
+
+#include "metagraph.h"
+
+/* densim-build: native replacement for construct_metagraph.py.
+
+   Reads a multiplex edge list ("layerID nodeID nodeID weight"), compacts node
+   ids and writes, into the output directory,
+     metagraph_<name>.txt    DIMACS metagraph, byte-identical to the Python builder
+     metagraph_<name>.bin    binary metagraph (see metagraph.h)
+     metagraph_<name>.maps   id maps and total similarity, read by main.py
+
+   Jaccard similarity depends only on an edge's layer set, so edges are grouped
+   into signature classes and layer counts are taken once per pair of classes.
+   Edge similarities are never stored: a first parallel pass counts the similar
+   partners of every edge and accumulates its similarity degree, a second pass
+   recomputes each row and streams it out, so memory stays linear in the input
+   apart from a bounded window of rows in flight. */
+
+#define ROW_BLOCK 64
+#define ROWS_PER_THREAD 8
+#define CACHED_LAYERS 256
+#define CLASS_TABLE_LIMIT 2048
+#define CAPACITY_LENGTH 32
+#define INFINITY 1.79769e+308
+
+typedef long long int llint;
+typedef unsigned long long int ullint;
+
+typedef struct idTable
+{
+	llint *keys;
+	int *values;
+	size_t capacity;
+	size_t size;
+} IdTable;
+
+typedef struct layerCounts
+{
+	int common;
+	int all;
+} LayerCounts;
+
+typedef struct multiplex
+{
+	int numEdges;
+	int numNodes;
+	int numLayers;
+	int numWords;
+	int numClasses;
+	llint *edgeTails;
+	llint *edgeHeads;
+	llint *nodeIds;
+	ullint *layers;
+	int *edgeClass;
+	int *classFirst;
+	int *classMembers;
+	LayerCounts *classPairs;
+	int *edgeNodes;
+	int *incidenceFirst;
+	int *incidence;
+} Multiplex;
+
+typedef struct touch
+{
+	int first;
+	int second;
+	int position;
+	int edge;
+} Touch;
+
+typedef struct similarityRows
+{
+	int *numPartners;
+	int *firstPartner;
+	double *simDegree;
+	double *discarded;
+	llint *numDiscarded;
+	double *cutoffSimilarity;
+	int *cutoffPartner;
+} SimilarityRows;
+
+typedef struct classSimilarity
+{
+	double similarity;
+	int members;
+	int index;
+} ClassSimilarity;
+
+/* Replacement for the similarity clique of one signature class: the members
+   pairwise similar with Jaccard 1. Each auxiliary node j takes an arc of
+   capacity weights[j] from every member and has one arc of capacity bounds[j]
+   to the sink; modular is added to the members' sink arcs. */
+typedef struct cliqueGadget
+{
+	int numSteps;
+	int firstAuxiliary;
+	double modular;
+	double *weights;
+	double *bounds;
+} CliqueGadget;
+
+typedef struct rowBuffer
+{
+	int node;
+	int numArcs;
+	int arcCapacity;
+	int *heads;
+	double *capacities;
+	char *text;
+	size_t textSize;
+	size_t textCapacity;
+	LayerCounts *classCounts;
+} RowBuffer;
+
+typedef struct builder
+{
+	const Multiplex *graph;
+	SimilarityRows rows;
+	double threshold;
+	int topK;
+	double gadgetError;
+	CliqueGadget *gadgets;
+	int numAuxiliary;
+	char (*capacityText)[CAPACITY_LENGTH];
+	int numNodes;
+	int source;
+	int sink;
+	llint numArcs;
+	llint *first;
+	int binaryFile;
+	off_t tailsOffset;
+	off_t headsOffset;
+	off_t capacitiesOffset;
+	RowBuffer *window;
+	int windowSize;
+	int nextRow;
+	int errorRow;
+} Builder;
+
+static void *
+allocate (size_t size)
+{
+	void *memory = malloc (size ? size : 1);
+
+	if (memory == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+	return memory;
+}
+
+static void *
+reallocate (void *memory, size_t size)
+{
+	if ((memory = realloc (memory, size ? size : 1)) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+	return memory;
+}
+
+static ullint
+hashKey (const llint first, const llint second)
+{
+	ullint hash = (ullint) first * 0x9E3779B97F4A7C15ULL ^ (ullint) second;
+
+	hash ^= hash >> 30;
+	hash *= 0xBF58476D1CE4E5B9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94D049BB133111EBULL;
+	return hash ^ (hash >> 31);
+}
+
+static void
+initializeTable (IdTable *table)
+{
+	table->capacity = 1024;
+	table->size = 0;
+	table->keys = (llint *) allocate (2 * table->capacity * sizeof (llint));
+	table->values = (int *) calloc (table->capacity, sizeof (int));
+	if (table->values == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+}
+
+static void
+freeTable (IdTable *table)
+{
+	free (table->keys);
+	free (table->values);
+}
+
+static size_t
+findSlot (const IdTable *table, const llint first, const llint second)
+{
+	size_t slot = (size_t) hashKey (first, second) & (table->capacity - 1);
+
+	while ((table->values[slot]) && ((table->keys[2*slot] != first) || (table->keys[2*slot+1] != second)))
+	{
+		slot = (slot + 1) & (table->capacity - 1);
+	}
+	return slot;
+}
+
+/* Returns the id stored for (first, second), assigning nextId when the key is
+   new; ids are positive so a zero value marks an empty slot. */
+static int
+lookupOrInsert (IdTable *table, const llint first, const llint second, const int nextId)
+{
+	size_t slot = findSlot (table, first, second), i, oldCapacity;
+	llint *oldKeys;
+	int *oldValues;
+
+	if (table->values[slot])
+	{
+		return table->values[slot];
+	}
+
+	if (2 * (table->size + 1) > table->capacity)
+	{
+		oldKeys = table->keys;
+		oldValues = table->values;
+		oldCapacity = table->capacity;
+
+		table->capacity *= 2;
+		table->keys = (llint *) allocate (2 * table->capacity * sizeof (llint));
+		if ((table->values = (int *) calloc (table->capacity, sizeof (int))) == NULL)
+		{
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
+		}
+
+		for (i=0; i<oldCapacity; ++i)
+		{
+			if (oldValues[i])
+			{
+				slot = findSlot (table, oldKeys[2*i], oldKeys[2*i+1]);
+				table->keys[2*slot] = oldKeys[2*i];
+				table->keys[2*slot+1] = oldKeys[2*i+1];
+				table->values[slot] = oldValues[i];
+			}
+		}
+		free (oldKeys);
+		free (oldValues);
+
+		slot = findSlot (table, first, second);
+	}
+
+	table->keys[2*slot] = first;
+	table->keys[2*slot+1] = second;
+	table->values[slot] = nextId;
+	++ table->size;
+
+	return nextId;
+}
+
+static int
+findNode (const IdTable *table, const llint node)
+{
+	return table->values[findSlot (table, node, 0)] - 1;
+}
+
+static const char *
+parseLong (const char *pos, llint *value)
+{
+	char *stop;
+
+	while (((*pos) == ' ') || ((*pos) == '\t'))
+	{
+		++ pos;
+	}
+	(*value) = strtoll (pos, &stop, 10);
+
+	if ((stop == pos) || (((*stop) != ' ') && ((*stop) != '\t') && ((*stop) != '\r') && ((*stop) != '\n') && ((*stop) != '\0')))
+	{
+		return NULL;
+	}
+	return stop;
+}
+
+/* Edge and node ids follow the Python builder: edges are numbered 1..m in
+   order of first appearance, then their endpoints m+1..m+n in the same order
+   (smaller endpoint first). Layers only need to be distinct bit positions. */
+static void
+readMultiplex (const char *filename, Multiplex *graph)
+{
+	FILE *file;
+	IdTable edges, layers;
+	char line[1024];
+	const char *pos;
+	llint layer, u, v, swap, *memberships = NULL;
+	int lineNumber = 0, numMemberships = 0, membershipCapacity = 0, edgeCapacity = 0, edge, i, nodeOrder = 0;
+	IdTable nodes;
+
+	if ((file = fopen (filename, "r")) == NULL)
+	{
+		printf ("%s, %d: Could not open %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+
+	initializeTable (&edges);
+	initializeTable (&layers);
+	initializeTable (&nodes);
+	memset (graph, 0, sizeof (Multiplex));
+
+	while (fgets (line, sizeof (line), file))
+	{
+		++ lineNumber;
+
+		if (((pos = parseLong (line, &layer)) == NULL) ||
+			((pos = parseLong (pos, &u)) == NULL) ||
+			((pos = parseLong (pos, &v)) == NULL))
+		{
+			printf ("%s, line %d: malformed edge line\n", filename, lineNumber);
+			exit (1);
+		}
+
+		if (u > v)
+		{
+			swap = u;
+			u = v;
+			v = swap;
+		}
+
+		edge = lookupOrInsert (&edges, u, v, graph->numEdges + 1);
+		if (edge > graph->numEdges)
+		{
+			if (graph->numEdges == edgeCapacity)
+			{
+				edgeCapacity = edgeCapacity ? 2*edgeCapacity : 1024;
+				graph->edgeTails = (llint *) reallocate (graph->edgeTails, edgeCapacity * sizeof (llint));
+				graph->edgeHeads = (llint *) reallocate (graph->edgeHeads, edgeCapacity * sizeof (llint));
+				graph->nodeIds = (llint *) reallocate (graph->nodeIds, 2 * edgeCapacity * sizeof (llint));
+			}
+			graph->edgeTails[graph->numEdges] = u;
+			graph->edgeHeads[graph->numEdges] = v;
+			++ graph->numEdges;
+
+			if (lookupOrInsert (&nodes, u, 0, nodeOrder + 1) > nodeOrder)
+			{
+				graph->nodeIds[nodeOrder++] = u;
+			}
+			if (lookupOrInsert (&nodes, v, 0, nodeOrder + 1) > nodeOrder)
+			{
+				graph->nodeIds[nodeOrder++] = v;
+			}
+		}
+
+		if (numMemberships == membershipCapacity)
+		{
+			membershipCapacity = membershipCapacity ? 2*membershipCapacity : 4096;
+			memberships = (llint *) reallocate (memberships, 2 * membershipCapacity * sizeof (llint));
+		}
+		memberships[2*numMemberships] = edge - 1;
+		memberships[2*numMemberships+1] = lookupOrInsert (&layers, layer, 0, graph->numLayers + 1) - 1;
+		if (memberships[2*numMemberships+1] == graph->numLayers)
+		{
+			++ graph->numLayers;
+		}
+		++ numMemberships;
+	}
+	fclose (file);
+
+	graph->numNodes = nodeOrder;
+	graph->numWords = (graph->numLayers + 63) / 64;
+	graph->layers = (ullint *) calloc ((size_t) graph->numEdges * graph->numWords + 1, sizeof (ullint));
+	graph->incidenceFirst = (int *) calloc (graph->numNodes + 1, sizeof (int));
+	graph->incidence = (int *) allocate (2 * graph->numEdges * sizeof (int));
+	if ((graph->layers == NULL) || (graph->incidenceFirst == NULL))
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	for (i=0; i<numMemberships; ++i)
+	{
+		layer = memberships[2*i+1];
+		graph->layers[memberships[2*i] * graph->numWords + layer / 64] |= 1ULL << (layer % 64);
+	}
+	free (memberships);
+
+	/* Incident edges of every node in id order; a self-loop is listed once,
+	   matching the single arc networkx keeps for it. */
+	graph->edgeNodes = (int *) allocate (2 * graph->numEdges * sizeof (int));
+	for (i=0; i<graph->numEdges; ++i)
+	{
+		graph->edgeNodes[2*i] = findNode (&nodes, graph->edgeTails[i]);
+		graph->edgeNodes[2*i+1] = findNode (&nodes, graph->edgeHeads[i]);
+		++ graph->incidenceFirst[graph->edgeNodes[2*i]];
+		if (graph->edgeNodes[2*i+1] != graph->edgeNodes[2*i])
+		{
+			++ graph->incidenceFirst[graph->edgeNodes[2*i+1]];
+		}
+	}
+	for (i=0; i<graph->numNodes; ++i)
+	{
+		graph->incidenceFirst[i+1] += graph->incidenceFirst[i];
+	}
+	for (i=graph->numEdges-1; i>=0; --i)
+	{
+		graph->incidence[--graph->incidenceFirst[graph->edgeNodes[2*i]]] = i + 1;
+		if (graph->edgeNodes[2*i+1] != graph->edgeNodes[2*i])
+		{
+			graph->incidence[--graph->incidenceFirst[graph->edgeNodes[2*i+1]]] = i + 1;
+		}
+	}
+
+	freeTable (&edges);
+	freeTable (&layers);
+	freeTable (&nodes);
+}
+
+static const Multiplex *sortedGraph;
+
+static int
+compareSignatures (const void *a, const void *b)
+{
+	const int x = *((const int *) a), y = *((const int *) b), numWords = sortedGraph->numWords;
+	const ullint *first = sortedGraph->layers + (size_t) x * numWords;
+	const ullint *second = sortedGraph->layers + (size_t) y * numWords;
+	int i;
+
+	for (i=0; i<numWords; ++i)
+	{
+		if (first[i] != second[i])
+		{
+			return (first[i] < second[i]) ? -1 : 1;
+		}
+	}
+	return x - y;
+}
+
+/* Layer-count kernels: class a against classes first .. first+count-1. With
+   up to 64 layers every signature is one word and the vector kernels handle
+   one class per 64-bit lane; wider signatures are split across lanes word by
+   word. The widest kernel the CPU supports is picked at start-up. */
+static void
+countLayersScalar (const Multiplex *graph, const int a, const int first, const int count, LayerCounts *out)
+{
+	const int numWords = graph->numWords;
+	const ullint *signature = graph->layers + (size_t) a * numWords, *other;
+	int k, i;
+
+	for (k=0; k<count; ++k)
+	{
+		other = graph->layers + (size_t) (first + k) * numWords;
+		out[k].common = 0;
+		out[k].all = 0;
+		for (i=0; i<numWords; ++i)
+		{
+			out[k].common += __builtin_popcountll (signature[i] & other[i]);
+			out[k].all += __builtin_popcountll (signature[i] | other[i]);
+		}
+	}
+}
+
+__attribute__ ((target ("popcnt"))) static void
+countLayersPopcnt (const Multiplex *graph, const int a, const int first, const int count, LayerCounts *out)
+{
+	const int numWords = graph->numWords;
+	const ullint *signature = graph->layers + (size_t) a * numWords, *other;
+	int k, i;
+
+	for (k=0; k<count; ++k)
+	{
+		other = graph->layers + (size_t) (first + k) * numWords;
+		out[k].common = 0;
+		out[k].all = 0;
+		for (i=0; i<numWords; ++i)
+		{
+			out[k].common += __builtin_popcountll (signature[i] & other[i]);
+			out[k].all += __builtin_popcountll (signature[i] | other[i]);
+		}
+	}
+}
+
+/* Per-lane popcount of four 64-bit words: nibble lookup, then byte sums. */
+__attribute__ ((target ("avx2"))) static inline __m256i
+popcountAvx2 (const __m256i words)
+{
+	const __m256i lookup = _mm256_setr_epi8 (0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8 (0x0f);
+	__m256i low = _mm256_and_si256 (words, nibble);
+	__m256i high = _mm256_and_si256 (_mm256_srli_epi16 (words, 4), nibble);
+
+	return _mm256_sad_epu8 (_mm256_add_epi8 (_mm256_shuffle_epi8 (lookup, low), _mm256_shuffle_epi8 (lookup, high)),
+		_mm256_setzero_si256 ());
+}
+
+__attribute__ ((target ("avx2,popcnt"))) static void
+countLayersAvx2 (const Multiplex *graph, const int a, const int first, const int count, LayerCounts *out)
+{
+	const int numWords = graph->numWords;
+	const ullint *signature = graph->layers + (size_t) a * numWords, *other;
+	llint common[4], all[4];
+	__m256i mine, theirs, commonSum, allSum;
+	int k = 0, i, lane;
+
+	if (numWords == 1)
+	{
+		mine = _mm256_set1_epi64x ((llint) signature[0]);
+		for ( ; k + 4 <= count; k += 4)
+		{
+			theirs = _mm256_loadu_si256 ((const __m256i *) (graph->layers + first + k));
+			_mm256_storeu_si256 ((__m256i *) common, popcountAvx2 (_mm256_and_si256 (mine, theirs)));
+			_mm256_storeu_si256 ((__m256i *) all, popcountAvx2 (_mm256_or_si256 (mine, theirs)));
+			for (lane=0; lane<4; ++lane)
+			{
+				out[k+lane].common = (int) common[lane];
+				out[k+lane].all = (int) all[lane];
+			}
+		}
+		countLayersPopcnt (graph, a, first + k, count - k, out + k);
+		return;
+	}
+
+	for ( ; k<count; ++k)
+	{
+		other = graph->layers + (size_t) (first + k) * numWords;
+		commonSum = _mm256_setzero_si256 ();
+		allSum = _mm256_setzero_si256 ();
+		for (i=0; i + 4 <= numWords; i += 4)
+		{
+			mine = _mm256_loadu_si256 ((const __m256i *) (signature + i));
+			theirs = _mm256_loadu_si256 ((const __m256i *) (other + i));
+			commonSum = _mm256_add_epi64 (commonSum, popcountAvx2 (_mm256_and_si256 (mine, theirs)));
+			allSum = _mm256_add_epi64 (allSum, popcountAvx2 (_mm256_or_si256 (mine, theirs)));
+		}
+		_mm256_storeu_si256 ((__m256i *) common, commonSum);
+		_mm256_storeu_si256 ((__m256i *) all, allSum);
+		out[k].common = (int) (common[0] + common[1] + common[2] + common[3]);
+		out[k].all = (int) (all[0] + all[1] + all[2] + all[3]);
+		for ( ; i<numWords; ++i)
+		{
+			out[k].common += __builtin_popcountll (signature[i] & other[i]);
+			out[k].all += __builtin_popcountll (signature[i] | other[i]);
+		}
+	}
+}
+
+__attribute__ ((target ("avx512f,avx512vpopcntdq,popcnt"))) static void
+countLayersAvx512 (const Multiplex *graph, const int a, const int first, const int count, LayerCounts *out)
+{
+	const int numWords = graph->numWords;
+	const ullint *signature = graph->layers + (size_t) a * numWords, *other;
+	llint common[8], all[8];
+	__m512i mine, theirs, commonSum, allSum;
+	__mmask8 mask;
+	int k = 0, i, lane;
+
+	if (numWords == 1)
+	{
+		mine = _mm512_set1_epi64 ((llint) signature[0]);
+		for ( ; k + 8 <= count; k += 8)
+		{
+			theirs = _mm512_loadu_si512 ((const void *) (graph->layers + first + k));
+			_mm512_storeu_si512 ((void *) common, _mm512_popcnt_epi64 (_mm512_and_si512 (mine, theirs)));
+			_mm512_storeu_si512 ((void *) all, _mm512_popcnt_epi64 (_mm512_or_si512 (mine, theirs)));
+			for (lane=0; lane<8; ++lane)
+			{
+				out[k+lane].common = (int) common[lane];
+				out[k+lane].all = (int) all[lane];
+			}
+		}
+		countLayersPopcnt (graph, a, first + k, count - k, out + k);
+		return;
+	}
+
+	for ( ; k<count; ++k)
+	{
+		other = graph->layers + (size_t) (first + k) * numWords;
+		commonSum = _mm512_setzero_si512 ();
+		allSum = _mm512_setzero_si512 ();
+		for (i=0; i<numWords; i += 8)
+		{
+			mask = (numWords - i >= 8) ? (__mmask8) 0xff : (__mmask8) ((1u << (numWords - i)) - 1);
+			mine = _mm512_maskz_loadu_epi64 (mask, signature + i);
+			theirs = _mm512_maskz_loadu_epi64 (mask, other + i);
+			commonSum = _mm512_add_epi64 (commonSum, _mm512_popcnt_epi64 (_mm512_and_si512 (mine, theirs)));
+			allSum = _mm512_add_epi64 (allSum, _mm512_popcnt_epi64 (_mm512_or_si512 (mine, theirs)));
+		}
+		out[k].common = (int) _mm512_reduce_add_epi64 (commonSum);
+		out[k].all = (int) _mm512_reduce_add_epi64 (allSum);
+	}
+}
+
+static void (*countLayers) (const Multiplex *graph, const int a, const int first, const int count, LayerCounts *out) = countLayersScalar;
+
+/* The widest supported kernel, or the requested one if the CPU has it. */
+static const char *
+selectLayerKernel (const char *requested)
+{
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vpopcntdq") &&
+		((requested == NULL) || (strcmp (requested, "avx512") == 0)))
+	{
+		countLayers = countLayersAvx512;
+		return "avx512";
+	}
+	if (__builtin_cpu_supports ("avx2") && ((requested == NULL) || (strcmp (requested, "avx2") == 0)))
+	{
+		countLayers = countLayersAvx2;
+		return "avx2";
+	}
+	if (__builtin_cpu_supports ("popcnt") && ((requested == NULL) || (strcmp (requested, "popcnt") == 0)))
+	{
+		countLayers = countLayersPopcnt;
+		return "popcnt";
+	}
+	countLayers = countLayersScalar;
+	return "scalar";
+}
+
+/* Layer counts of class a against every class: a row of the table when it
+   exists, otherwise computed into the caller's buffer. */
+static const LayerCounts *
+classRow (const Multiplex *graph, const int a, LayerCounts *buffer)
+{
+	if (graph->classPairs)
+	{
+		return graph->classPairs + (size_t) a * graph->numClasses;
+	}
+	countLayers (graph, a, 0, graph->numClasses, buffer);
+	return buffer;
+}
+
+/* Groups edges with identical layer sets. Members of a class are listed in
+   id order and the per-edge bitmasks are replaced by one per class; the
+   layer counts of every class pair are tabulated when the table is small. */
+static void
+buildSignatureClasses (Multiplex *graph)
+{
+	const int numEdges = graph->numEdges, numWords = graph->numWords;
+	ullint *signatures;
+	int i, a, b, numClasses = 0;
+
+	graph->edgeClass = (int *) allocate (numEdges * sizeof (int));
+	graph->classMembers = (int *) allocate (numEdges * sizeof (int));
+	graph->classFirst = (int *) allocate ((numEdges + 1) * sizeof (int));
+
+	for (i=0; i<numEdges; ++i)
+	{
+		graph->classMembers[i] = i;
+	}
+	sortedGraph = graph;
+	qsort (graph->classMembers, numEdges, sizeof (int), compareSignatures);
+
+	for (i=0; i<numEdges; ++i)
+	{
+		if ((i == 0) || memcmp (graph->layers + (size_t) graph->classMembers[i] * numWords,
+			graph->layers + (size_t) graph->classMembers[i-1] * numWords, numWords * sizeof (ullint)))
+		{
+			graph->classFirst[numClasses++] = i;
+		}
+		graph->edgeClass[graph->classMembers[i]] = numClasses - 1;
+	}
+	graph->classFirst[numClasses] = numEdges;
+	graph->numClasses = numClasses;
+
+	signatures = (ullint *) allocate ((size_t) numClasses * numWords * sizeof (ullint) + 1);
+	for (a=0; a<numClasses; ++a)
+	{
+		memcpy (signatures + (size_t) a * numWords, graph->layers + (size_t) graph->classMembers[graph->classFirst[a]] * numWords,
+			numWords * sizeof (ullint));
+	}
+	free (graph->layers);
+	graph->layers = signatures;
+
+	graph->classPairs = NULL;
+	if (numClasses <= CLASS_TABLE_LIMIT)
+	{
+		graph->classPairs = (LayerCounts *) allocate ((size_t) numClasses * numClasses * sizeof (LayerCounts));
+		for (a=0; a<numClasses; ++a)
+		{
+			countLayers (graph, a, a, numClasses - a, graph->classPairs + (size_t) a * numClasses + a);
+			for (b=a+1; b<numClasses; ++b)
+			{
+				graph->classPairs[(size_t) b * numClasses + a] = graph->classPairs[(size_t) a * numClasses + b];
+			}
+		}
+	}
+}
+
+/* Shortest round-trip decimal in the layout of Python's repr(float), so the
+   text metagraph is byte-identical to the one networkx writes. */
+static int
+formatCapacity (const double value, char *text)
+{
+	char buffer[CAPACITY_LENGTH], digits[CAPACITY_LENGTH], *pos = text;
+	int precision, numDigits = 0, exponent, point, i;
+	const char *scan;
+
+	if (value == 0)
+	{
+		return sprintf (text, "0.0");
+	}
+
+	for (precision = 1; precision < 17; ++precision)
+	{
+		snprintf (buffer, sizeof (buffer), "%.*e", precision-1, value);
+		if (strtod (buffer, NULL) == value)
+		{
+			break;
+		}
+	}
+	snprintf (buffer, sizeof (buffer), "%.*e", precision-1, value);
+
+	scan = buffer;
+	if ((*scan) == '-')
+	{
+		*pos++ = '-';
+		++ scan;
+	}
+	for ( ; (*scan) != 'e'; ++ scan)
+	{
+		if ((*scan) != '.')
+		{
+			digits[numDigits++] = (*scan);
+		}
+	}
+	while ((numDigits > 1) && (digits[numDigits-1] == '0'))
+	{
+		-- numDigits;
+	}
+	exponent = atoi (scan + 1);
+	point = exponent + 1;
+
+	if ((point > 16) || (point < -3))
+	{
+		*pos++ = digits[0];
+		if (numDigits > 1)
+		{
+			*pos++ = '.';
+			memcpy (pos, digits + 1, numDigits - 1);
+			pos += numDigits - 1;
+		}
+		pos += sprintf (pos, "e%c%02d", (exponent < 0) ? '-' : '+', (exponent < 0) ? -exponent : exponent);
+	}
+	else if (point <= 0)
+	{
+		*pos++ = '0';
+		*pos++ = '.';
+		for (i=point; i<0; ++i)
+		{
+			*pos++ = '0';
+		}
+		memcpy (pos, digits, numDigits);
+		pos += numDigits;
+	}
+	else
+	{
+		for (i=0; i<point; ++i)
+		{
+			*pos++ = (i < numDigits) ? digits[i] : '0';
+		}
+		*pos++ = '.';
+		if (numDigits > point)
+		{
+			memcpy (pos, digits + point, numDigits - point);
+			pos += numDigits - point;
+		}
+		else
+		{
+			*pos++ = '0';
+		}
+	}
+
+	*pos = '\0';
+	return (int) (pos - text);
+}
+
+static char *
+formatInt (int value, char *pos)
+{
+	char reversed[12];
+	int length = 0;
+
+	do
+	{
+		reversed[length++] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value);
+
+	while (length)
+	{
+		*pos++ = reversed[--length];
+	}
+	return pos;
+}
+
+/* The clique part of the cut when s of the k members stay out of the
+   subgraph: s(k-1)/2 on their sink arcs plus s(k-s)/2 on the arcs into the
+   selected members. It is concave in s, so with h the interpolation at
+   breakpoints b_0 = 0, b_1 = 1, b_{j+1} <= (1+error) b_j we get
+   h <= g <= (1+error) h. Each interior breakpoint costs one auxiliary node
+   realising min (c_j s, c_j b_j); the last slope is modular. */
+static double
+cliqueCut (const int k, const int s)
+{
+	return 0.5 * s * (2.0*k - 1 - s);
+}
+
+static void
+buildCliqueGadgets (Builder *builder)
+{
+	const Multiplex *graph = builder->graph;
+	CliqueGadget *gadget;
+	int a, k, j, numBreakpoints, next, *breakpoints;
+	double *slopes;
+
+	builder->gadgets = (CliqueGadget *) calloc (graph->numClasses, sizeof (CliqueGadget));
+	breakpoints = (int *) allocate ((graph->numEdges + 2) * sizeof (int));
+	slopes = (double *) allocate ((graph->numEdges + 2) * sizeof (double));
+	if (builder->gadgets == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	builder->numAuxiliary = 0;
+	if ((builder->gadgetError <= 0) || (builder->threshold > 1))
+	{
+		free (breakpoints);
+		free (slopes);
+		return;
+	}
+
+	for (a=0; a<graph->numClasses; ++a)
+	{
+		k = graph->classFirst[a+1] - graph->classFirst[a];
+		if (k < 3)
+		{
+			continue;
+		}
+
+		breakpoints[0] = 0;
+		breakpoints[1] = 1;
+		for (numBreakpoints=2; breakpoints[numBreakpoints-1] < k; ++numBreakpoints)
+		{
+			next = (int) (breakpoints[numBreakpoints-1] * (1 + builder->gadgetError));
+			if (next <= breakpoints[numBreakpoints-1])
+			{
+				next = breakpoints[numBreakpoints-1] + 1;
+			}
+			breakpoints[numBreakpoints] = (next < k) ? next : k;
+		}
+
+		if ((llint) (numBreakpoints - 2) * (k + 1) >= (llint) k * (k - 1))
+		{
+			continue;
+		}
+
+		for (j=1; j<numBreakpoints; ++j)
+		{
+			slopes[j] = (cliqueCut (k, breakpoints[j]) - cliqueCut (k, breakpoints[j-1])) / (breakpoints[j] - breakpoints[j-1]);
+		}
+
+		gadget = &builder->gadgets[a];
+		gadget->numSteps = numBreakpoints - 2;
+		gadget->firstAuxiliary = builder->numNodes + builder->numAuxiliary + 1;
+		gadget->modular = slopes[numBreakpoints-1];
+		gadget->weights = (double *) allocate (gadget->numSteps * sizeof (double));
+		gadget->bounds = (double *) allocate (gadget->numSteps * sizeof (double));
+		for (j=0; j<gadget->numSteps; ++j)
+		{
+			gadget->weights[j] = slopes[j+1] - slopes[j+2];
+			gadget->bounds[j] = gadget->weights[j] * breakpoints[j+1];
+		}
+		builder->numAuxiliary += gadget->numSteps;
+	}
+
+	free (breakpoints);
+	free (slopes);
+}
+
+static void
+reportGadgets (const Builder *builder)
+{
+	const Multiplex *graph = builder->graph;
+	llint cliqueArcs = 0, gadgetArcs = 0;
+	int a, k, numCliques = 0;
+
+	for (a=0; a<graph->numClasses; ++a)
+	{
+		if (builder->gadgets[a].numSteps)
+		{
+			k = graph->classFirst[a+1] - graph->classFirst[a];
+			cliqueArcs += (llint) k * (k - 1);
+			gadgetArcs += (llint) builder->gadgets[a].numSteps * (k + 1);
+			++ numCliques;
+		}
+	}
+
+	if (numCliques)
+	{
+		printf ("replaced %d signature cliques (%lld arcs) by %d auxiliary nodes (%lld arcs), relative cut error at most %g\n",
+			numCliques, cliqueArcs, builder->numAuxiliary, gadgetArcs, builder->gadgetError);
+	}
+}
+
+static int
+compareClassSimilarity (const void *a, const void *b)
+{
+	const ClassSimilarity *x = (const ClassSimilarity *) a, *y = (const ClassSimilarity *) b;
+
+	if (x->similarity != y->similarity)
+	{
+		return (x->similarity > y->similarity) ? -1 : 1;
+	}
+	return x->index - y->index;
+}
+
+static int
+compareInts (const void *a, const void *b)
+{
+	return *((const int *) a) - *((const int *) b);
+}
+
+/* Top-k cutoff of every edge: partners are ranked by decreasing similarity,
+   then increasing id, and an edge keeps those ranked above its cutoff
+   (similarity, partner). Members of a class share the ranking of classes, so
+   it is sorted once per class. */
+static void *
+scanCutoffs (void *arg)
+{
+	Builder *builder = (Builder *) arg;
+	const Multiplex *graph = builder->graph;
+	LayerCounts *buffer = graph->classPairs ? NULL : (LayerCounts *) allocate (graph->numClasses * sizeof (LayerCounts));
+	ClassSimilarity *ranking = (ClassSimilarity *) allocate (graph->numClasses * sizeof (ClassSimilarity));
+	int *tied = (int *) allocate (graph->numEdges * sizeof (int));
+	const LayerCounts *counts;
+	int a, b, k, x, numRanked, before, group, end, numTied, member;
+
+	while ((a = __sync_fetch_and_add (&builder->nextRow, 1)) < graph->numClasses)
+	{
+		counts = classRow (graph, a, buffer);
+		numRanked = 0;
+		for (b=0; b<graph->numClasses; ++b)
+		{
+			if ((counts[b].common) && ((double) counts[b].common / counts[b].all >= builder->threshold))
+			{
+				ranking[numRanked].similarity = (double) counts[b].common / counts[b].all;
+				ranking[numRanked].members = graph->classFirst[b+1] - graph->classFirst[b] - (b == a);
+				ranking[numRanked].index = b;
+				++ numRanked;
+			}
+		}
+		qsort (ranking, numRanked, sizeof (ClassSimilarity), compareClassSimilarity);
+
+		for (k=graph->classFirst[a]; k<graph->classFirst[a+1]; ++k)
+		{
+			x = graph->classMembers[k];
+			builder->rows.cutoffSimilarity[x] = 0;
+			builder->rows.cutoffPartner[x] = INT_MAX;
+
+			for (before=0, group=0; group<numRanked; group=end)
+			{
+				for (end=group+1; (end < numRanked) && (ranking[end].similarity == ranking[group].similarity); ++end);
+				for (b=group, numTied=0; b<end; ++b)
+				{
+					numTied += ranking[b].members;
+				}
+				if (before + numTied < builder->topK)
+				{
+					before += numTied;
+					continue;
+				}
+
+				for (b=group, numTied=0; b<end; ++b)
+				{
+					for (member=graph->classFirst[ranking[b].index]; member<graph->classFirst[ranking[b].index+1]; ++member)
+					{
+						if (graph->classMembers[member] != x)
+						{
+							tied[numTied++] = graph->classMembers[member];
+						}
+					}
+				}
+				qsort (tied, numTied, sizeof (int), compareInts);
+				builder->rows.cutoffSimilarity[x] = ranking[group].similarity;
+				builder->rows.cutoffPartner[x] = tied[builder->topK - before - 1];
+				break;
+			}
+		}
+	}
+
+	free (buffer);
+	free (ranking);
+	free (tied);
+	return NULL;
+}
+
+static inline int
+keptBy (const Builder *builder, const int x, const int y, const double similarity)
+{
+	return (similarity > builder->rows.cutoffSimilarity[x]) ||
+		((similarity == builder->rows.cutoffSimilarity[x]) && (y <= builder->rows.cutoffPartner[x]));
+}
+
+/* A similar pair survives sparsification if it reaches the threshold and,
+   in top-k mode, is among the k best partners of either edge. */
+static inline int
+keepPair (const Builder *builder, const int x, const int y, const double similarity)
+{
+	if (similarity < builder->threshold)
+	{
+		return 0;
+	}
+	return (builder->topK == 0) || keptBy (builder, x, y, similarity) || keptBy (builder, y, x, similarity);
+}
+
+/* First pass: number of kept partners, the smallest of them, and the
+   similarity degree summed over kept partners in id order as
+   read_multi_layer does; the similarity of dropped pairs is tallied. */
+static void *
+scanRows (void *arg)
+{
+	Builder *builder = (Builder *) arg;
+	const Multiplex *graph = builder->graph;
+	LayerCounts *buffer = graph->classPairs ? NULL : (LayerCounts *) allocate (graph->numClasses * sizeof (LayerCounts));
+	const LayerCounts *counts = NULL;
+	int start, x, y, a, b, last = -1, partners, firstPartner;
+	llint numDiscarded;
+	double degree, discarded, similarity;
+
+	while ((start = __sync_fetch_and_add (&builder->nextRow, ROW_BLOCK)) < graph->numEdges)
+	{
+		for (x=start; (x < start + ROW_BLOCK) && (x < graph->numEdges); ++x)
+		{
+			a = graph->edgeClass[x];
+			if (a != last)
+			{
+				counts = classRow (graph, a, buffer);
+				last = a;
+			}
+			partners = 0;
+			firstPartner = 0;
+			numDiscarded = 0;
+			degree = 0;
+			discarded = 0;
+
+			for (y=0; y<graph->numEdges; ++y)
+			{
+				b = graph->edgeClass[y];
+				if ((y == x) || (counts[b].common == 0) || ((b == a) && builder->gadgets[a].numSteps))
+				{
+					continue;
+				}
+				similarity = (double) counts[b].common / counts[b].all;
+				if (keepPair (builder, x, y, similarity))
+				{
+					if (partners == 0)
+					{
+						firstPartner = y + 1;
+					}
+					++ partners;
+					degree += similarity;
+				}
+				else
+				{
+					++ numDiscarded;
+					discarded += similarity;
+				}
+			}
+
+			builder->rows.numPartners[x] = partners;
+			builder->rows.firstPartner[x] = firstPartner;
+			builder->rows.simDegree[x] = degree;
+			builder->rows.numDiscarded[x] = numDiscarded;
+			builder->rows.discarded[x] = discarded;
+		}
+	}
+
+	free (buffer);
+	return NULL;
+}
+
+static void
+reserveRow (RowBuffer *row, const int numArcs)
+{
+	if (numArcs > row->arcCapacity)
+	{
+		row->arcCapacity = numArcs;
+		row->heads = (int *) reallocate (row->heads, numArcs * sizeof (int));
+		row->capacities = (double *) reallocate (row->capacities, numArcs * sizeof (double));
+	}
+	if ((size_t) numArcs * (26 + CAPACITY_LENGTH) > row->textCapacity)
+	{
+		row->textCapacity = (size_t) numArcs * (26 + CAPACITY_LENGTH);
+		row->text = (char *) reallocate (row->text, row->textCapacity);
+	}
+	row->numArcs = 0;
+	row->textSize = 0;
+}
+
+static void
+appendArc (RowBuffer *row, const int tail, const int head, const double capacity, const char *capacityText)
+{
+	char *pos = row->text + row->textSize, formatted[CAPACITY_LENGTH];
+
+	if (capacityText == NULL)
+	{
+		formatCapacity (capacity, formatted);
+		capacityText = formatted;
+	}
+
+	*pos++ = 'a';
+	*pos++ = ' ';
+	pos = formatInt (tail, pos);
+	*pos++ = ' ';
+	pos = formatInt (head, pos);
+	*pos++ = ' ';
+	while (*capacityText)
+	{
+		*pos++ = *capacityText++;
+	}
+	*pos++ = '\n';
+
+	row->heads[row->numArcs] = head;
+	row->capacities[row->numArcs] = capacity;
+	++ row->numArcs;
+	row->textSize = pos - row->text;
+}
+
+/* Out-arcs of one metagraph node in networkx insertion order: similar edges
+   then the sink for an edge-vertex, every edge- and node-vertex for the
+   source, incident edges for a node-vertex. */
+static void
+fillRow (Builder *builder, RowBuffer *row)
+{
+	const Multiplex *graph = builder->graph;
+	const int node = row->node, numEdges = graph->numEdges, stride = graph->numLayers + 1;
+	const LayerCounts *counts;
+	const CliqueGadget *gadget;
+	int x, y, i, a, common, all;
+
+	if (node <= numEdges)
+	{
+		x = node - 1;
+		gadget = &builder->gadgets[graph->edgeClass[x]];
+		reserveRow (row, builder->rows.numPartners[x] + 1 + gadget->numSteps);
+		if ((graph->classPairs == NULL) && (row->classCounts == NULL))
+		{
+			row->classCounts = (LayerCounts *) allocate (graph->numClasses * sizeof (LayerCounts));
+		}
+		counts = classRow (graph, graph->edgeClass[x], row->classCounts);
+
+		for (y=0; y<numEdges; ++y)
+		{
+			if ((y == x) || (gadget->numSteps && (graph->edgeClass[y] == graph->edgeClass[x])))
+			{
+				continue;
+			}
+			common = counts[graph->edgeClass[y]].common;
+			all = counts[graph->edgeClass[y]].all;
+			if ((common) && keepPair (builder, x, y, (double) common / all))
+			{
+				appendArc (row, node, y + 1, ((double) common / all) / 2,
+					builder->capacityText ? builder->capacityText[common * stride + all] : NULL);
+			}
+		}
+		appendArc (row, node, builder->sink, builder->rows.simDegree[x] / 2 + gadget->modular, NULL);
+		for (i=0; i<gadget->numSteps; ++i)
+		{
+			appendArc (row, node, gadget->firstAuxiliary + i, gadget->weights[i], NULL);
+		}
+	}
+	else if (node > builder->sink)
+	{
+		reserveRow (row, 1);
+		for (a=0; (builder->gadgets[a].numSteps == 0) ||
+			(node >= builder->gadgets[a].firstAuxiliary + builder->gadgets[a].numSteps); ++a);
+		appendArc (row, node, builder->sink, builder->gadgets[a].bounds[node - builder->gadgets[a].firstAuxiliary], NULL);
+	}
+	else if (node == builder->source)
+	{
+		reserveRow (row, numEdges + graph->numNodes);
+		for (i=1; i<=numEdges + graph->numNodes; ++i)
+		{
+			appendArc (row, node, i, 0.0, "0.0");
+		}
+	}
+	else if (node != builder->sink)
+	{
+		x = node - numEdges - 1;
+		reserveRow (row, graph->incidenceFirst[x+1] - graph->incidenceFirst[x]);
+		for (i=graph->incidenceFirst[x]; i<graph->incidenceFirst[x+1]; ++i)
+		{
+			appendArc (row, node, graph->incidence[i], INFINITY, "1.79769e+308");
+		}
+	}
+	else
+	{
+		reserveRow (row, 0);
+	}
+}
+
+static int
+writeAll (const int fd, const void *data, const size_t size, const off_t offset)
+{
+	const char *pos = (const char *) data;
+	size_t done = 0;
+	ssize_t written;
+
+	while (done < size)
+	{
+		if ((written = pwrite (fd, pos + done, size - done, offset + done)) <= 0)
+		{
+			return 0;
+		}
+		done += written;
+	}
+	return 1;
+}
+
+/* Rows of the window are filled in parallel; each worker writes its binary
+   arcs at their CSR offsets, the text is written afterwards in window order.
+   The heads array is reused for the tails once the heads are on disk. */
+static void *
+fillWindow (void *arg)
+{
+	Builder *builder = (Builder *) arg;
+	RowBuffer *row;
+	llint start;
+	int i, j;
+
+	while ((i = __sync_fetch_and_add (&builder->nextRow, 1)) < builder->windowSize)
+	{
+		row = &builder->window[i];
+		fillRow (builder, row);
+		start = builder->first[row->node - 1];
+
+		if (!writeAll (builder->binaryFile, row->heads, row->numArcs * sizeof (int), builder->headsOffset + start * sizeof (int)) ||
+			!writeAll (builder->binaryFile, row->capacities, row->numArcs * sizeof (double), builder->capacitiesOffset + start * sizeof (double)))
+		{
+			builder->errorRow = row->node;
+		}
+
+		for (j=0; j<row->numArcs; ++j)
+		{
+			row->heads[j] = row->node;
+		}
+		if (!writeAll (builder->binaryFile, row->heads, row->numArcs * sizeof (int), builder->tailsOffset + start * sizeof (int)))
+		{
+			builder->errorRow = row->node;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+runThreads (Builder *builder, void *(*worker) (void *), const int numThreads)
+{
+	pthread_t *threads = (pthread_t *) allocate (numThreads * sizeof (pthread_t));
+	int i;
+
+	builder->nextRow = 0;
+	for (i=0; i<numThreads; ++i)
+	{
+		pthread_create (&threads[i], NULL, worker, builder);
+	}
+	for (i=0; i<numThreads; ++i)
+	{
+		pthread_join (threads[i], NULL);
+	}
+	free (threads);
+}
+
+static int
+compareTouches (const void *a, const void *b)
+{
+	const Touch *x = (const Touch *) a, *y = (const Touch *) b;
+
+	if (x->first != y->first)
+	{
+		return (x->first < y->first) ? -1 : 1;
+	}
+	if (x->second != y->second)
+	{
+		return (x->second < y->second) ? -1 : 1;
+	}
+	return x->position - y->position;
+}
+
+static int
+edgeBefore (const Multiplex *graph, const int x, const int y)
+{
+	if (graph->edgeTails[x] != graph->edgeTails[y])
+	{
+		return graph->edgeTails[x] < graph->edgeTails[y];
+	}
+	return graph->edgeHeads[x] < graph->edgeHeads[y];
+}
+
+/* Order in which read_multi_layer / construct_graph first touch the edges
+   that have a similar partner. The first pair naming an edge is always the
+   one with its smallest partner; within a pair the dictionaries see the lower
+   id first, the metagraph the lexicographically smaller edge. */
+static int
+sortFirstTouches (const Builder *builder, const int byTuple, Touch *touches)
+{
+	const Multiplex *graph = builder->graph;
+	int x, partner, numTouches = 0;
+
+	for (x=0; x<graph->numEdges; ++x)
+	{
+		if (builder->rows.numPartners[x] == 0)
+		{
+			continue;
+		}
+		partner = builder->rows.firstPartner[x] - 1;
+		touches[numTouches].first = (x < partner) ? x : partner;
+		touches[numTouches].second = (x < partner) ? partner : x;
+		touches[numTouches].position = byTuple ? edgeBefore (graph, partner, x) : (x > partner);
+		touches[numTouches].edge = x;
+		++ numTouches;
+	}
+
+	qsort (touches, numTouches, sizeof (Touch), compareTouches);
+	return numTouches;
+}
+
+static void
+buildNodeOrder (const Builder *builder, int *order)
+{
+	const Multiplex *graph = builder->graph;
+	const int numEdges = graph->numEdges;
+	Touch *touches = (Touch *) allocate (numEdges * sizeof (Touch));
+	char *seen = (char *) calloc (builder->numNodes + 1, sizeof (char));
+	int numTouches, numOrdered = 0, i, node, k;
+
+	if (seen == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	numTouches = sortFirstTouches (builder, 1, touches);
+	for (i=0; i<numTouches; ++i)
+	{
+		order[numOrdered++] = touches[i].edge + 1;
+		seen[touches[i].edge + 1] = 1;
+	}
+
+	order[numOrdered++] = builder->source;
+	seen[builder->source] = 1;
+
+	for (i=0; i<numEdges; ++i)
+	{
+		if (!seen[i+1])
+		{
+			order[numOrdered++] = i + 1;
+			seen[i+1] = 1;
+		}
+		if (!seen[builder->sink])
+		{
+			order[numOrdered++] = builder->sink;
+			seen[builder->sink] = 1;
+		}
+		for (k=0; k<2; ++k)
+		{
+			node = numEdges + graph->edgeNodes[2*i+k] + 1;
+			if (!seen[node])
+			{
+				order[numOrdered++] = node;
+				seen[node] = 1;
+			}
+		}
+	}
+
+	for (node=builder->sink+1; node<=builder->numNodes; ++node)
+	{
+		order[numOrdered++] = node;
+	}
+
+	free (touches);
+	free (seen);
+}
+
+/* sum(simdegree.values()) in the dictionary's insertion order, so main.py
+   sees the very same total as with the pickled maps. */
+static double
+totalSimilarity (const Builder *builder)
+{
+	Touch *touches = (Touch *) allocate (builder->graph->numEdges * sizeof (Touch));
+	int numTouches = sortFirstTouches (builder, 0, touches), i, k;
+	double total = 0;
+
+	for (i=0; i<numTouches; ++i)
+	{
+		total += builder->rows.simDegree[touches[i].edge];
+	}
+	for (i=0; i<builder->graph->numClasses; ++i)
+	{
+		if (builder->gadgets[i].numSteps)
+		{
+			k = builder->graph->classFirst[i+1] - builder->graph->classFirst[i];
+			total += (double) k * (k - 1);
+		}
+	}
+
+	free (touches);
+	return total;
+}
+
+static void
+writeMaps (const Builder *builder, const char *filename)
+{
+	const Multiplex *graph = builder->graph;
+	FILE *file;
+	char total[CAPACITY_LENGTH];
+	int i;
+
+	if ((file = fopen (filename, "w")) == NULL)
+	{
+		printf ("%s, %d: Could not open %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+
+	formatCapacity (totalSimilarity (builder), total);
+	fprintf (file, "c edge-vertex and node-vertex ids of the metagraph\n");
+	fprintf (file, "t %s %d %d\n", total, graph->numEdges, graph->numNodes);
+	for (i=0; i<graph->numEdges; ++i)
+	{
+		fprintf (file, "e %d %lld %lld\n", i + 1, graph->edgeTails[i], graph->edgeHeads[i]);
+	}
+	for (i=0; i<graph->numNodes; ++i)
+	{
+		fprintf (file, "v %d %lld\n", graph->numEdges + i + 1, graph->nodeIds[i]);
+	}
+
+	fclose (file);
+}
+
+static void
+buildCapacityText (Builder *builder)
+{
+	const int numLayers = builder->graph->numLayers, stride = numLayers + 1;
+	int common, all;
+
+	builder->capacityText = NULL;
+	if (numLayers > CACHED_LAYERS)
+	{
+		return;
+	}
+
+	builder->capacityText = (char (*)[CAPACITY_LENGTH]) allocate ((size_t) stride * stride * CAPACITY_LENGTH);
+	for (all=1; all<=numLayers; ++all)
+	{
+		for (common=1; common<=all; ++common)
+		{
+			formatCapacity (((double) common / all) / 2, builder->capacityText[common * stride + all]);
+		}
+	}
+}
+
+static void
+writeMetagraph (Builder *builder, const char *textName, const char *binaryName, const int numThreads)
+{
+	const Multiplex *graph = builder->graph;
+	MetagraphHeader header;
+	FILE *text;
+	int *order, i, j, a, k, windowCapacity = numThreads * ROWS_PER_THREAD;
+	llint *counts;
+
+	builder->first = (llint *) allocate ((builder->numNodes + 1) * sizeof (llint));
+	counts = builder->first + 1;
+	builder->first[0] = 0;
+	for (i=0; i<graph->numEdges; ++i)
+	{
+		counts[i] = builder->rows.numPartners[i] + 1;
+	}
+	for (i=0; i<graph->numNodes; ++i)
+	{
+		counts[graph->numEdges + i] = graph->incidenceFirst[i+1] - graph->incidenceFirst[i];
+	}
+	counts[builder->source - 1] = graph->numEdges + graph->numNodes;
+	counts[builder->sink - 1] = 0;
+	for (a=0; a<graph->numClasses; ++a)
+	{
+		for (j=0; j<builder->gadgets[a].numSteps; ++j)
+		{
+			counts[builder->gadgets[a].firstAuxiliary - 1 + j] = 1;
+		}
+		for (k=graph->classFirst[a]; (builder->gadgets[a].numSteps) && (k < graph->classFirst[a+1]); ++k)
+		{
+			counts[graph->classMembers[k]] += builder->gadgets[a].numSteps;
+		}
+	}
+	for (i=1; i<=builder->numNodes; ++i)
+	{
+		builder->first[i] += builder->first[i-1];
+	}
+	builder->numArcs = builder->first[builder->numNodes];
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, METAGRAPH_MAGIC, sizeof (header.magic));
+	header.version = METAGRAPH_VERSION;
+	header.headerSize = sizeof (MetagraphHeader);
+	header.numNodes = builder->numNodes;
+	header.numArcs = builder->numArcs;
+	header.source = builder->source;
+	header.sink = builder->sink;
+	header.numEdges = graph->numEdges;
+
+	builder->tailsOffset = sizeof (MetagraphHeader) + (builder->numNodes + 1) * sizeof (llint);
+	builder->headsOffset = builder->tailsOffset + builder->numArcs * sizeof (int);
+	builder->capacitiesOffset = builder->headsOffset + builder->numArcs * sizeof (int);
+
+	if (((text = fopen (textName, "w")) == NULL) ||
+		((builder->binaryFile = open (binaryName, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0))
+	{
+		printf ("%s, %d: Could not open output files %s, %s.\n", __FILE__, __LINE__, textName, binaryName);
+		exit (1);
+	}
+	setvbuf (text, NULL, _IOFBF, 1 << 20);
+
+	if (!writeAll (builder->binaryFile, &header, sizeof (header), 0) ||
+		!writeAll (builder->binaryFile, builder->first, (builder->numNodes + 1) * sizeof (llint), sizeof (header)))
+	{
+		printf ("%s, %d: Could not write %s.\n", __FILE__, __LINE__, binaryName);
+		exit (1);
+	}
+
+	fprintf (text, "p par-max %d %lld\n", builder->numNodes, builder->numArcs);
+	fprintf (text, "n %d s\n", builder->source);
+	fprintf (text, "n %d t\n", builder->sink);
+
+	order = (int *) allocate (builder->numNodes * sizeof (int));
+	buildNodeOrder (builder, order);
+
+	builder->window = (RowBuffer *) calloc (windowCapacity, sizeof (RowBuffer));
+	if (builder->window == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	for (i=0; i<builder->numNodes; i+=windowCapacity)
+	{
+		builder->windowSize = (builder->numNodes - i < windowCapacity) ? builder->numNodes - i : windowCapacity;
+		for (j=0; j<builder->windowSize; ++j)
+		{
+			builder->window[j].node = order[i+j];
+		}
+
+		runThreads (builder, fillWindow, numThreads);
+
+		if (builder->errorRow)
+		{
+			printf ("%s, %d: Could not write %s.\n", __FILE__, __LINE__, binaryName);
+			exit (1);
+		}
+		for (j=0; j<builder->windowSize; ++j)
+		{
+			fwrite (builder->window[j].text, 1, builder->window[j].textSize, text);
+		}
+	}
+
+	if ((fclose (text) != 0) || (close (builder->binaryFile) != 0))
+	{
+		printf ("%s, %d: Could not write %s, %s.\n", __FILE__, __LINE__, textName, binaryName);
+		exit (1);
+	}
+
+	for (j=0; j<windowCapacity; ++j)
+	{
+		free (builder->window[j].heads);
+		free (builder->window[j].capacities);
+		free (builder->window[j].text);
+		free (builder->window[j].classCounts);
+	}
+	free (builder->window);
+	free (builder->first);
+	free (order);
+}
+
+static void
+freeMultiplex (Multiplex *graph)
+{
+	free (graph->edgeTails);
+	free (graph->edgeHeads);
+	free (graph->nodeIds);
+	free (graph->layers);
+	free (graph->edgeClass);
+	free (graph->classFirst);
+	free (graph->classMembers);
+	free (graph->classPairs);
+	free (graph->edgeNodes);
+	free (graph->incidenceFirst);
+	free (graph->incidence);
+}
+
+/* Every pair is seen from both ends, hence the halving. */
+static void
+reportSparsification (const Builder *builder)
+{
+	const Multiplex *graph = builder->graph;
+	double kept = 0, discarded = 0;
+	llint numKept = 0, numDiscarded = 0;
+	int x;
+
+	if ((builder->threshold <= 0) && (builder->topK == 0))
+	{
+		return;
+	}
+
+	for (x=0; x<graph->numEdges; ++x)
+	{
+		numKept += builder->rows.numPartners[x];
+		numDiscarded += builder->rows.numDiscarded[x];
+		kept += builder->rows.simDegree[x];
+		discarded += builder->rows.discarded[x];
+	}
+
+	printf ("sparsification kept %lld of %lld similar pairs, discarded similarity %g of %g (%.2f%%)\n",
+		numKept / 2, (numKept + numDiscarded) / 2, discarded / 2, (kept + discarded) / 2,
+		(kept + discarded > 0) ? 100 * discarded / (kept + discarded) : 0.0);
+}
+
+static void
+usage (const char *program)
+{
+	printf ("Usage: %s [-d dataset] [-i indir] [-o outdir] [-t threads] [-j threshold] [-n topk] [-g error] [-k avx512|avx2|popcnt|scalar]\n", program);
+	printf ("  -j keeps similar pairs with Jaccard at least threshold, -n the k most similar partners of each edge\n");
+	printf ("  -g replaces signature cliques by auxiliary nodes, within a relative cut error\n");
+	printf ("Builds <outdir>/metagraph_<dataset>.{txt,bin,maps} from <indir>/<dataset>.edges\n");
+	exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+	const char *dataset = "CS-Aarhus_multiplex", *indir = "Data", *outdir = "Data", *kernel = NULL;
+	char inputName[4096], textName[4096], binaryName[4096], mapsName[4096];
+	int numThreads = (int) sysconf (_SC_NPROCESSORS_ONLN), option, topK = 0, a;
+	double threshold = 0, gadgetError = 0;
+	Multiplex graph;
+	Builder builder;
+
+	while ((option = getopt (argc, argv, "d:i:o:t:j:n:g:k:h")) != -1)
+	{
+		switch (option)
+		{
+		case 'd':
+			dataset = optarg;
+			break;
+		case 'i':
+			indir = optarg;
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
+		case 't':
+			numThreads = atoi (optarg);
+			break;
+		case 'j':
+			threshold = atof (optarg);
+			break;
+		case 'n':
+			topK = atoi (optarg);
+			break;
+		case 'g':
+			gadgetError = atof (optarg);
+			break;
+		case 'k':
+			kernel = optarg;
+			break;
+		default:
+			usage (argv[0]);
+		}
+	}
+	if (numThreads < 1)
+	{
+		numThreads = 1;
+	}
+
+	snprintf (inputName, sizeof (inputName), "%s/%s.edges", indir, dataset);
+	snprintf (textName, sizeof (textName), "%s/metagraph_%s.txt", outdir, dataset);
+	snprintf (binaryName, sizeof (binaryName), "%s/metagraph_%s.bin", outdir, dataset);
+	snprintf (mapsName, sizeof (mapsName), "%s/metagraph_%s.maps", outdir, dataset);
+
+	printf ("read input file (%s layer kernel)\n", selectLayerKernel (kernel));
+	readMultiplex (inputName, &graph);
+	buildSignatureClasses (&graph);
+	printf ("%d edges in %d layer signatures\n", graph.numEdges, graph.numClasses);
+
+	memset (&builder, 0, sizeof (builder));
+	builder.graph = &graph;
+	builder.numNodes = graph.numEdges + graph.numNodes + 2;
+	builder.source = graph.numEdges + graph.numNodes + 1;
+	builder.sink = graph.numEdges + graph.numNodes + 2;
+	builder.threshold = threshold;
+	builder.topK = topK;
+	builder.gadgetError = gadgetError;
+	builder.rows.discarded = (double *) allocate (graph.numEdges * sizeof (double));
+	builder.rows.numDiscarded = (llint *) allocate (graph.numEdges * sizeof (llint));
+	builder.rows.cutoffSimilarity = (double *) allocate (graph.numEdges * sizeof (double));
+	builder.rows.cutoffPartner = (int *) allocate (graph.numEdges * sizeof (int));
+	builder.rows.numPartners = (int *) allocate (graph.numEdges * sizeof (int));
+	builder.rows.firstPartner = (int *) allocate (graph.numEdges * sizeof (int));
+	builder.rows.simDegree = (double *) allocate (graph.numEdges * sizeof (double));
+
+	printf ("construct metagraph\n");
+	if ((topK > 0) && (builder.gadgetError > 0))
+	{
+		printf ("-g cannot be combined with -n: top-k sparsification breaks the signature cliques\n");
+		exit (1);
+	}
+	if (topK > 0)
+	{
+		runThreads (&builder, scanCutoffs, numThreads);
+	}
+	buildCliqueGadgets (&builder);
+	builder.numNodes += builder.numAuxiliary;
+	reportGadgets (&builder);
+	runThreads (&builder, scanRows, numThreads);
+	reportSparsification (&builder);
+	buildCapacityText (&builder);
+
+	printf ("write metagraph\n");
+	writeMetagraph (&builder, textName, binaryName, numThreads);
+	writeMaps (&builder, mapsName);
+
+	for (a=0; a<graph.numClasses; ++a)
+	{
+		free (builder.gadgets[a].weights);
+		free (builder.gadgets[a].bounds);
+	}
+	free (builder.gadgets);
+	free (builder.rows.discarded);
+	free (builder.rows.numDiscarded);
+	free (builder.rows.cutoffSimilarity);
+	free (builder.rows.cutoffPartner);
+	free (builder.rows.numPartners);
+	free (builder.rows.firstPartner);
+	free (builder.rows.simDegree);
+	free (builder.capacityText);
+	freeMultiplex (&graph);
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef METAGRAPH_H
+#define METAGRAPH_H
+
+/* Binary metagraph container, written by construct_metagraph.py and
+   convert_metagraph.py and mapped read-only by the solver.
+
+   MetagraphHeader (64 bytes), followed by
+     long long first[numNodes+1]   arcs of node i are first[i-1] .. first[i]-1
+     int       tails[numArcs]      1-based node ids, non-decreasing
+     int       heads[numArcs]      1-based node ids
+     double    capacities[numArcs]
+
+   All values are stored in the byte order of the machine that wrote them. */
+
+#define METAGRAPH_MAGIC "DSMGRAPH"
+#define METAGRAPH_VERSION 1
+
+typedef struct metagraphHeader
+{
+	char magic[8];
+	int version;
+	int headerSize;
+	long long numNodes;
+	long long numArcs;
+	long long source;
+	long long sink;
+	long long numEdges;
+	long long reserved;
+} MetagraphHeader;
+
+#endif
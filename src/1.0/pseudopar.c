@@ -3,36 +3,250 @@
 #include <sys/resource.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "metagraph.h"
 
 //#define VERBOSE
 #define PROGRESS
 #define RECOVER_FLOW
 #define STATS
+//#define FIXED_POINT
+//#define LARGE_GRAPHS
 
 #define EPSILON 1e-10
+#define WARM_START_MARGIN 1e-9
+#define DIMACS_CHUNK_SIZE (1 << 20)
 #define INFINITY 1.79769e+308
+#define CAPACITY_SCALE 1048576.0
 
 typedef long long int llint;
 
-static char *
-getNextWord (char *line, char *word)
+/* With FIXED_POINT, capacities, flows and excesses are integers in units of
+   1/capacityScale: inputs are rounded once when they enter the graph, and from then
+   on the flow arithmetic and its zero tests are exact. Values are kept below
+   2^61/numNodes in magnitude: the source and sink arcs bound every excess and flow,
+   so no sum reaches the 2^62 of the infinite arcs. */
+#ifdef FIXED_POINT
+typedef llint Capacity;
+#define CAPACITY_INFINITY (1LL << 62)
+#define CAPACITY_EPSILON 0
+#else
+typedef double Capacity;
+#define CAPACITY_INFINITY INFINITY
+#define CAPACITY_EPSILON EPSILON
+#endif
+
+/* Arc counts are 64-bit throughout, but the arc indices the solver stores per node
+   (out-of-tree lists, terminal and relabel offsets) are 32-bit unless LARGE_GRAPHS is
+   set; the readers refuse graphs with more arcs than an ArcIndex can address. */
+#ifdef LARGE_GRAPHS
+typedef llint ArcIndex;
+#define MAX_ARC_INDEX LLONG_MAX
+#else
+typedef int ArcIndex;
+#define MAX_ARC_INDEX INT_MAX
+#endif
+
+static const double powersOfTen[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *
+skipBlanks (const char *pos, const char *end)
+{
+	while ((pos < end) && (((*pos) == ' ') || ((*pos) == '\t') || ((*pos) == '\r')))
+	{
+		++ pos;
+	}
+	return pos;
+}
+
+static const char *
+parseLong (const char *pos, const char *end, llint *value)
 {
-	int wordlength = 0;
+	llint result = 0;
+	int negative = 0;
+	const char *digits;
 
-	while (((*line) == ' ') || ((*line) == '\t') || ((*line) == '\n') || ((*line) == '\0'))
+	pos = skipBlanks (pos, end);
+
+	if ((pos < end) && (((*pos) == '-') || ((*pos) == '+')))
 	{
-		++ line;
+		negative = ((*pos) == '-');
+		++ pos;
 	}
 
-	while (((*line) != ' ') && ((*line) != '\t') && ((*line) != '\n') && ((*line) != '\0'))
+	for (digits = pos; (pos < end) && ((*pos) >= '0') && ((*pos) <= '9'); ++ pos)
 	{
-		word[wordlength] = (*line);
-		++ wordlength;
-		++ line; 
+		if (result > (LLONG_MAX - ((*pos) - '0')) / 10)
+		{
+			return NULL;
+		}
+		result = 10*result + ((*pos) - '0');
 	}
-	
-	word[wordlength] = '\0';
-	return line;
+
+	if ((pos == digits) || ((pos < end) && ((*pos) != ' ') && ((*pos) != '\t') && ((*pos) != '\r') && ((*pos) != '\n')))
+	{
+		return NULL;
+	}
+
+	(*value) = (negative ? -result : result);
+	return pos;
+}
+
+static const char *
+parseInt (const char *pos, const char *end, int *value)
+{
+	llint result;
+
+	if (((pos = parseLong (pos, end, &result)) == NULL) || (result > INT_MAX) || (result < -INT_MAX))
+	{
+		return NULL;
+	}
+
+	(*value) = (int) result;
+	return pos;
+}
+
+/* Exact for decimals with at most 15 significant digits and a small exponent
+   (the common case for Jaccard capacities); every other token goes through strtod
+   on a bounded copy so the result is always correctly rounded. */
+static const char *
+parseDouble (const char *pos, const char *end, double *value)
+{
+	unsigned long long mantissa = 0;
+	int negative = 0, numDigits = 0, exponent = 0, expValue = 0, expNegative = 0, fast = 1;
+	const char *start, *tokenEnd, *digits, *expDigits;
+	char buffer[64], *stop;
+
+	start = skipBlanks (pos, end);
+	for (tokenEnd = start; (tokenEnd < end) && ((*tokenEnd) != ' ') && ((*tokenEnd) != '\t') &&
+		((*tokenEnd) != '\r') && ((*tokenEnd) != '\n'); ++ tokenEnd);
+
+	if (tokenEnd == start)
+	{
+		return NULL;
+	}
+
+	pos = start;
+	if (((*pos) == '-') || ((*pos) == '+'))
+	{
+		negative = ((*pos) == '-');
+		++ pos;
+	}
+
+	for (digits = pos; (pos < tokenEnd) && ((*pos) >= '0') && ((*pos) <= '9'); ++ pos)
+	{
+		if ((mantissa == 0) && ((*pos) == '0'))
+		{
+			continue;
+		}
+		if (numDigits < 15)
+		{
+			mantissa = 10*mantissa + ((*pos) - '0');
+		}
+		else
+		{
+			++ exponent;
+		}
+		++ numDigits;
+	}
+
+	if ((pos < tokenEnd) && ((*pos) == '.'))
+	{
+		for (++ pos; (pos < tokenEnd) && ((*pos) >= '0') && ((*pos) <= '9'); ++ pos)
+		{
+			if ((mantissa == 0) && ((*pos) == '0'))
+			{
+				-- exponent;
+				continue;
+			}
+			if (numDigits < 15)
+			{
+				mantissa = 10*mantissa + ((*pos) - '0');
+				-- exponent;
+			}
+			++ numDigits;
+		}
+	}
+
+	if ((pos == digits) || ((pos == digits+1) && ((*digits) == '.')))
+	{
+		fast = 0;
+	}
+
+	if (fast && (pos < tokenEnd) && (((*pos) == 'e') || ((*pos) == 'E')))
+	{
+		++ pos;
+		if ((pos < tokenEnd) && (((*pos) == '-') || ((*pos) == '+')))
+		{
+			expNegative = ((*pos) == '-');
+			++ pos;
+		}
+		for (expDigits = pos; (pos < tokenEnd) && ((*pos) >= '0') && ((*pos) <= '9') && (expValue < 10000); ++ pos)
+		{
+			expValue = 10*expValue + ((*pos) - '0');
+		}
+		exponent += expNegative ? -expValue : expValue;
+
+		// "1e" or "2E+" is left to strtod, which rejects it.
+		if (pos == expDigits)
+		{
+			fast = 0;
+		}
+	}
+
+	if (fast && (pos == tokenEnd) && (numDigits <= 15) && (exponent >= -22) && (exponent <= 22))
+	{
+		(*value) = (exponent < 0) ? (double) mantissa / powersOfTen[-exponent] : (double) mantissa * powersOfTen[exponent];
+		if (negative)
+		{
+			(*value) = -(*value);
+		}
+		return tokenEnd;
+	}
+
+	if ((size_t) (tokenEnd - start) >= sizeof (buffer))
+	{
+		return NULL;
+	}
+
+	memcpy (buffer, start, tokenEnd - start);
+	buffer[tokenEnd - start] = '\0';
+	(*value) = strtod (buffer, &stop);
+
+	return ((stop != buffer) && ((*stop) == '\0')) ? tokenEnd : NULL;
+}
+
+static const char *
+nextLine (const char *pos, const char *end)
+{
+	const char *newline = (const char *) memchr (pos, '\n', end - pos);
+
+	return newline ? (newline + 1) : end;
+}
+
+/* Comments and blank lines are the only lines a DIMACS reader skips. */
+static int
+isCommentLine (const char *pos, const char *end)
+{
+	if ((*pos) == 'c')
+	{
+		return 1;
+	}
+
+	pos = skipBlanks (pos, end);
+
+	return (pos == end) || ((*pos) == '\n');
 }
 
 double 
@@ -48,41 +262,62 @@ struct node;
 
 typedef struct arc 
 {
-	struct node *from;
-	struct node *to;
-	double flow;
-	double capacity;
-    double base_capacity;
+	int from;
+	int to;
+	Capacity flow;
+	Capacity capacity;
 	int direction;
+	int rescanLabel;
 	//int *capacities;
 } Arc;
 
-typedef struct edge 
+typedef struct topology 
 {
-	int from;
-    int to;
-	double capacity;
-} Edge;
+	int numNodes;
+	llint numArcs;
+	int source;
+	int sink;
+	llint *first;
+	int *tails;
+	int *heads;
+	double *capacities;
+	void *mapping;
+	size_t mappingSize;
+	int refCount;
+} Topology;
 
 typedef struct node 
 {
-	int visited;
-	int numAdjacent;
 	int number;
 	int label;
-	double excess;
+	Capacity excess;
 	struct node *parent;
 	struct node *childList;
 	struct node *nextScan;
 	int numOutOfTree;
-	Arc **outOfTree;
 	int nextArc;
+	ArcIndex *outOfTree;
 	Arc *arcToParent;
 	struct node *next;
 	struct node *prev;
-	//int breakpoint;
 } Node;
 
+/* Node fields the solve loop never touches, kept apart so that Node stays small. */
+typedef struct coldNode
+{
+	int numAdjacent;
+	int visited;
+	int breakpoint;
+} ColdNode;
+
+
+/* An arc between two inner nodes, as seen from one of its ends. */
+typedef struct incidence
+{
+	Capacity capacity;
+	int other;
+	int outgoing;
+} Incidence;
 
 typedef struct root 
 {
@@ -90,33 +325,88 @@ typedef struct root
 	Node *end;
 } Root;
 
-//---------------  Global variables ------------------
-static int numNodes = 0;
-static int numArcs = 0;
-static int source = 0;
-static int sink = 0;
-static Edge *initEdgeList = NULL;
-
-
-
-static int numParams = 0;
-
-static int highestStrongLabel = 1;
-
-static Node *adjacencyList = NULL;
-static Root *strongRoots = NULL;
-static int *labelCount = NULL;
-static Arc *arcList = NULL;
-//-----------------------------------------------------
+typedef struct solution
+{
+	double lambda;
+	double similarity;
+	double density;
+	int size;
+	int *edges;
+} Solution;
+
+//---------------  Solver context ------------------
+typedef struct ps_solver
+{
+	int numNodes;
+	llint numArcs;
+	int source;
+	int sink;
+	int numEdges;
+	int numAuxiliary;
+	Topology *graph;
+
+	int numParams;
+	int theParam;
+
+	int highestStrongLabel;
+
+	Node *adjacencyList;
+	ColdNode *coldList;
+	ArcIndex *outOfTreeSpace;
+	int renumber;
+	int *newIndex;
+	int *oldIndex;
+	Root *strongRoots;
+	Node *rootSentinels;
+	unsigned long long *bucketBits;
+	int numBucketLevels;
+	int bucketLevelStart[8];
+	int *labelCount;
+	Arc *arcList;
+	llint *firstIncident;
+	Incidence *incident;
+	ArcIndex *firstTerminal;
+	Arc **terminal;
+
+	Capacity cutValue;
+	double cutError;
+	int numInfiniteCut;
+	int cutEdges;
+	int cutNodes;
+
+	double relabelFrequency;
+	llint relabelWork;
+
+	double capacityScale;
+	int *relabelSpace;
+	ArcIndex *relabelFirst;
 
 #ifdef STATS
-static llint numPushes = 0;
-static int numMergers = 0;
-static int numRelabels = 0;
-static int numGaps = 0;
-static llint numArcScans = 0;
+	llint numPushes;
+	llint numMergers;
+	llint numRelabels;
+	llint numGaps;
+	llint numArcScans;
+	llint numDetaches;
+	llint numWalksSaved;
+	llint numGlobalRelabels;
 #endif
 
+	int *cutSet;
+	int *prevCutSet;
+	int *querySet;
+	int cutSetSize;
+	int prevCutSetSize;
+	int querySetSize;
+	int warmStart;
+	double lastSimilarity;
+	double lastDensity;
+
+	Solution *frontier;
+	int numSolutions;
+} ps_solver;
+//-----------------------------------------------------
+
 static void
 initializeNode (Node *nd, const int n)
 {
@@ -130,24 +420,16 @@ initializeNode (Node *nd, const int n)
 	nd->arcToParent = NULL;
 	nd->next = NULL;
 	nd->prev = NULL;
-	nd->visited = 0;
-	nd->numAdjacent = 0;
 	nd->number = n;
 	nd->outOfTree = NULL;
-	//nd->breakpoint = (numParams+1);
 }
 
+/* The two sentinels of a bucket live side by side in the solver's sentinel arena. */
 static void
-initializeRoot (Root *rt) 
+initializeRoot (Root *rt, Node *sentinels) 
 {
-	rt->start = (Node *) malloc (sizeof(Node));
-	rt->end = (Node *) malloc (sizeof(Node));
-
-	if ((rt->start == NULL) || (rt->end == NULL))
-	{
-		printf ("%s Line %d: Out of memory\n", __FILE__, __LINE__);
-		exit (1);
-	}
+	rt->start = &sentinels[0];
+	rt->end = &sentinels[1];
 
 	initializeNode (rt->start, 0);
 	initializeNode (rt->end, 0);
@@ -156,1588 +438,3764 @@ initializeRoot (Root *rt)
 	rt->end->prev = rt->start;
 }
 
-
-static void
-freeRoot (Root *rt) 
+static inline void
+emptyRoot (Root *rt) 
 {
-	free(rt->start);
-	rt->start = NULL;
-
-	free(rt->end);
-	rt->end = NULL;
+	rt->start->next = rt->end;
+	rt->end->prev = rt->start;
 }
 
-static void
-//liftAll (Node *rootNode, const int theparam) 
-liftAll (Node *rootNode) 
+/* Builders may number auxiliary gadget nodes after the source and the sink;
+   they belong neither to the edge-vertices nor to the node-vertices. */
+static inline int
+isAuxiliary (const ps_solver *ps, const int number)
 {
-	Node *temp, *current=rootNode;
-
-	current->nextScan = current->childList;
+	return (number > ps->source) && (number > ps->sink);
+}
 
-	-- labelCount[current->label];
-	current->label = numNodes;	
-	//current->breakpoint = (theparam+1);
+static inline Capacity
+toCapacity (const ps_solver *ps, const double x)
+{
+#ifdef FIXED_POINT
+	double scaled = x * ps->capacityScale, limit = (double) (1LL << 61) / ps->numNodes;
 
-	for ( ; (current); current = current->parent)
+	if (x >= INFINITY)
 	{
-		while (current->nextScan) 
-		{
-			temp = current->nextScan;
-			current->nextScan = current->nextScan->next;
-			current = temp;
-			current->nextScan = current->childList;
+		return CAPACITY_INFINITY;
+	}
 
-			-- labelCount[current->label];
-			current->label = numNodes;
-		}
+	if ((scaled > limit) || (scaled < -limit))
+	{
+		printf ("c Error: capacity %g does not fit the fixed-point scale %g.\n", x, ps->capacityScale);
+		exit (1);
 	}
+
+	return (Capacity) ((scaled < 0) ? (scaled - .5) : (scaled + .5));
+#else
+	return x;
+#endif
 }
 
-static void
-addToStrongBucket (Node *newRoot, Node *rootEnd) 
+static inline double
+fromCapacity (const ps_solver *ps, const Capacity x)
 {
-	newRoot->next = rootEnd;
-	newRoot->prev = rootEnd->prev;
-	rootEnd->prev = newRoot;
-	newRoot->prev->next = newRoot;
+#ifdef FIXED_POINT
+	return (x >= CAPACITY_INFINITY) ? INFINITY : x / ps->capacityScale;
+#else
+	return x;
+#endif
 }
 
-static void
-createOutOfTree (Node *nd)
+/* The nearest value a capacity can take; the identity on the double path. */
+static inline double
+roundCapacity (const ps_solver *ps, const double x)
 {
-	if (nd->numAdjacent)
-	{
-		if ((nd->outOfTree = (Arc **) malloc (nd->numAdjacent * sizeof (Arc *))) == NULL)
-		{
-			printf ("%s Line %d: Out of memory\n", __FILE__, __LINE__);
-			exit (1);
-		}
-	}
+	return fromCapacity (ps, toCapacity (ps, x));
 }
 
-static void
-initializeArc (Arc *ac)
+/* The capacity an arc was read with; the shared topology keeps it, so the arc itself need not. */
+static inline Capacity
+baseCapacity (const ps_solver *ps, const Arc *ac)
 {
-	//int i;
-
-	ac->from = NULL;
-	ac->to = NULL;
-	ac->capacity = 0;
-    ac->base_capacity = 0;
-	ac->flow = 0;
-	ac->direction = 1;
+	return toCapacity (ps, ps->graph->capacities[ac - ps->arcList]);
 }
 
-static void
-addOutOfTreeNode (Node *n, Arc *out) 
+static inline int
+isCutArc (const ps_solver *ps, const Arc *ac)
 {
-	n->outOfTree[n->numOutOfTree] = out;
-	++ n->numOutOfTree;
+	return (ps->adjacencyList[ac->from].label >= ps->numNodes) && (ps->adjacencyList[ac->to].label < ps->numNodes);
 }
 
-static void
-reCreateGraph(const int num_edges, const double lambda, const double c) 
+/* The cut value is kept as a compensated (Neumaier) sum: the source-adjacent capacities
+   are large and of both signs, and plain accumulation drifts away from a fresh scan.
+   Fixed-point sums are exact. */
+static inline void
+addToCut (ps_solver *ps, const Capacity x)
 {
-	int i, capacity, from, to, first=0;
-	Arc *ac = NULL;
-
+#ifdef FIXED_POINT
+	ps->cutValue += x;
+#else
+	double t = ps->cutValue + x;
 
-	if ((adjacencyList = (Node *) malloc (numNodes * sizeof (Node))) == NULL)
+	if (((ps->cutValue < 0) ? -ps->cutValue : ps->cutValue) >= ((x < 0) ? -x : x))
 	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
+		ps->cutError += (ps->cutValue - t) + x;
 	}
-
-	if ((strongRoots = (Root *) malloc (numNodes * sizeof (Root))) == NULL)
+	else
 	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
+		ps->cutError += (x - t) + ps->cutValue;
 	}
+	ps->cutValue = t;
+#endif
+}
 
-	if ((labelCount = (int *) malloc (numNodes * sizeof (int))) == NULL)
+/* Infinite arcs are counted instead of summed, so that lifting a node before
+   its heads does not wipe out the finite part of the cut value. */
+static inline void
+addCutArc (ps_solver *ps, const Arc *ac, const int sign)
+{
+	if (ac->capacity >= CAPACITY_INFINITY)
 	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
+		ps->numInfiniteCut += sign;
 	}
-
-	if ((arcList = (Arc *) malloc (numArcs * sizeof (Arc))) == NULL)
+	else
 	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
+		addToCut (ps, sign * ac->capacity);
 	}
-          
-	for (i=0; i<numNodes; ++i)
+}
+
+/* Called right before nd is lifted out of the set of nodes with label < numNodes:
+   its arcs from lifted nodes stop crossing the cut, its arcs to unlifted ones start to. */
+static void
+leaveSet (ps_solver *ps, Node *nd)
+{
+	int i = nd - ps->adjacencyList, k;
+	llint j, last = ps->firstIncident[i+1];
+	const Incidence *inc;
+	Capacity delta = 0;
+
+	for (j=ps->firstIncident[i]; j<last; ++j)
 	{
-		initializeRoot (&strongRoots[i]);
-		initializeNode (&adjacencyList[i], (i+1));
-		labelCount[i] = 0;
+		inc = &ps->incident[j];
+		if ((ps->adjacencyList[inc->other].label < ps->numNodes) == inc->outgoing)
+		{
+			if (inc->capacity >= CAPACITY_INFINITY)
+			{
+				ps->numInfiniteCut += (inc->outgoing ? 1 : -1);
+			}
+			else
+			{
+				delta += (inc->outgoing ? inc->capacity : -inc->capacity);
+			}
+		}
 	}
+	addToCut (ps, delta);
 
-	for (i=0; i<numArcs; ++i)
+	// The source is always lifted and the sink never is.
+	for (k=ps->firstTerminal[i]; k<ps->firstTerminal[i+1]; ++k)
 	{
-		initializeArc (&arcList[i]);
+		addCutArc (ps, ps->terminal[k], ((ps->terminal[k]->to == i) ? -1 : 1));
 	}
-    for (i=0; i<numArcs; ++i)
-    {
-
-        from = initEdgeList[i].from;		
-        to = initEdgeList[i].to;
-
-        ac = &arcList[first];
 
-        ac->from = &adjacencyList[from-1];
-        ac->to = &adjacencyList[to-1];
-              
-        
-        ac->capacity = initEdgeList[i].capacity;
-        ac->base_capacity = ac->capacity;
-        
-        if (from == source)
-        {
-            if (to <= num_edges)
-            {
-                ac->capacity = c;
-            } else {
-                ac->capacity = lambda;
-            }
-        }
-        ++ first;
+	if (nd->number <= ps->numEdges)
+	{
+		-- ps->cutEdges;
+	}
+	else if (!isAuxiliary (ps, nd->number))
+	{
+		-- ps->cutNodes;
+	}
+}
 
-        ++ ac->from->numAdjacent;
-        ++ ac->to->numAdjacent;
-    }
-		
+/* Recomputes the cut value and the set sizes after an initialization, which leaves
+   only the source lifted; from then on leaveSet and the capacity updates keep them
+   current. */
+static void
+countCut (ps_solver *ps)
+{
+	int i;
 
-	for (i=0; i<numNodes; ++i) 
+	ps->cutValue = 0;
+	ps->cutError = 0;
+	ps->numInfiniteCut = 0;
+	for (i=0; i<ps->firstTerminal[ps->numNodes]; ++i) 
 	{
-		createOutOfTree (&adjacencyList[i]);
+		if (ps->terminal[i]->from == (ps->source-1))
+		{
+			addCutArc (ps, ps->terminal[i], 1);
+		}
 	}
 
-	for (i=0; i<numArcs; i++) 
+	ps->cutEdges = 0;
+	ps->cutNodes = -1;
+	for (i=0; i<ps->numNodes; ++i)
 	{
-		to = arcList[i].to->number;
-		from = arcList[i].from->number;
-		capacity = arcList[i].capacity;
-
-		if (!((source == to) || (sink == from) || (from == to))) 
+		if ((ps->adjacencyList[i].label < ps->numNodes) && !isAuxiliary (ps, ps->adjacencyList[i].number))
 		{
-			if ((source == from) && (to == sink)) 
-			{
-				arcList[i].flow = capacity;
-			}
-			else if (from == source)
-			{
-				addOutOfTreeNode (&adjacencyList[from-1], &arcList[i]);
-			}
-			else if (to == sink)
+			if (ps->adjacencyList[i].number <= ps->numEdges)
 			{
-				addOutOfTreeNode (&adjacencyList[to-1], &arcList[i]);
+				++ ps->cutEdges;
 			}
 			else
 			{
-				addOutOfTreeNode (&adjacencyList[from-1], &arcList[i]);
+				++ ps->cutNodes;
 			}
 		}
 	}
 }
 
-
 static void
-readDimacsFileCreateList (const char *filename) 
+liftAll (ps_solver *ps, Node *rootNode) 
 {
-	int lineLength=32768, i, capacity, numLines = 0, from, to, first=0;
-	char *line, *word, ch, ch1, *tmpline;
-	Arc *ac = NULL;
-    printf ("Read filename %s\n", filename);
-    FILE *file = fopen(filename, "r");
+	Node *temp, *current=rootNode;
 
-	if ((line = (char *) malloc ((lineLength+1) * sizeof (char))) == NULL)
-	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
-	}
+	current->nextScan = current->childList;
 
-	if ((word = (char *) malloc ((lineLength+1) * sizeof (char))) == NULL)
-	{
-		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-		exit (1);
-	}
+	leaveSet (ps, current);
+	-- ps->labelCount[current->label];
+	current->label = ps->numNodes;	
+	ps->coldList[current - ps->adjacencyList].breakpoint = (ps->theParam+1);
 
-	while (fgets (line, lineLength, file))
+	for ( ; (current); current = current->parent)
 	{
-		++ numLines;
-
-#ifdef VERBOSE
-		printf ("Read line %s\n", line);
-#endif
-
-		switch (*line)
+		while (current->nextScan) 
 		{
-		case 'p':
+			temp = current->nextScan;
+			current->nextScan = current->nextScan->next;
+			current = temp;
+			current->nextScan = current->childList;
 
-			//sscanf (line, "%c %s %d %d %d", &ch, word, &numNodes, &numArcs, &numParams);
-            sscanf (line, "%c %s %d %d", &ch, word, &numNodes, &numArcs);
+			leaveSet (ps, current);
+			-- ps->labelCount[current->label];
+			current->label = ps->numNodes;
+			ps->coldList[current - ps->adjacencyList].breakpoint = (ps->theParam+1);
+		}
+	}
+}
 
-#ifdef VERBOSE
-			printf ("numNodes: %d, numArcs: %d, numParams: %d\n", 
-				numNodes,
-				numArcs,
-				numParams);
-#endif
+/* Non-empty strong buckets are tracked in a 64-ary bitmap: bit l of level 0 is set
+   while bucket l is non-empty, and bit w of level k+1 while word w of level k is
+   non-zero; the top level is a single word. */
+static inline void
+markBucket (ps_solver *ps, int label)
+{
+	int level;
+	unsigned long long *word;
 
-			if ((adjacencyList = (Node *) malloc (numNodes * sizeof (Node))) == NULL)
-			{
-				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-				exit (1);
-			}
+	for (level=0; level<ps->numBucketLevels; ++level)
+	{
+		word = &ps->bucketBits[ps->bucketLevelStart[level] + (label >> 6)];
+		if (*word)
+		{
+			*word |= (1ULL << (label & 63));
+			return;
+		}
+		*word = (1ULL << (label & 63));
+		label >>= 6;
+	}
+}
 
-			if ((strongRoots = (Root *) malloc (numNodes * sizeof (Root))) == NULL)
-			{
-				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-				exit (1);
-			}
+static inline void
+unmarkBucket (ps_solver *ps, int label)
+{
+	int level;
+	unsigned long long *word;
 
-			if ((labelCount = (int *) malloc (numNodes * sizeof (int))) == NULL)
-			{
-				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-				exit (1);
-			}
+	for (level=0; level<ps->numBucketLevels; ++level)
+	{
+		word = &ps->bucketBits[ps->bucketLevelStart[level] + (label >> 6)];
+		*word &= ~(1ULL << (label & 63));
+		if (*word)
+		{
+			return;
+		}
+		label >>= 6;
+	}
+}
 
-			if ((arcList = (Arc *) malloc (numArcs * sizeof (Arc))) == NULL)
-			{
-				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-				exit (1);
-			}
-            
-            if ((initEdgeList = (Edge *) malloc (numArcs * sizeof (Edge))) == NULL)
-			{
-				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
-				exit (1);
-			}
-           
-			for (i=0; i<numNodes; ++i)
-			{
-				initializeRoot (&strongRoots[i]);
-				initializeNode (&adjacencyList[i], (i+1));
-				labelCount[i] = 0;
-			}
+/* Returns the highest non-empty bucket at or below limit, or -1 if there is none. */
+static int
+highestBucket (ps_solver *ps, int limit)
+{
+	int level = 0, pos = limit;
+	unsigned long long word;
 
-			for (i=0; i<numArcs; ++i)
-			{
-				initializeArc (&arcList[i]);
-			}
+	for (;;)
+	{
+		if (pos < 0)
+		{
+			return -1;
+		}
+
+		word = ps->bucketBits[ps->bucketLevelStart[level] + (pos >> 6)];
+		if ((pos & 63) < 63)
+		{
+			word &= (1ULL << ((pos & 63) + 1)) - 1;
+		}
 
+		if (word)
+		{
+			pos = (pos & ~63) | (63 - __builtin_clzll (word));
 			break;
+		}
 
-		case 'a':
+		if (level == ps->numBucketLevels-1)
+		{
+			return -1;
+		}
 
-			tmpline = line;
-			++ tmpline;
+		pos = (pos >> 6) - 1;
+		++ level;
+	}
 
-			tmpline = getNextWord (tmpline, word);			
-			from = (int) atoi (word);
+	for ( ; level > 0; --level)
+	{
+		word = ps->bucketBits[ps->bucketLevelStart[level-1] + pos];
+		pos = (pos << 6) | (63 - __builtin_clzll (word));
+	}
 
-			tmpline = getNextWord (tmpline, word);			
-			to = (int) atoi (word);
+	return pos;
+}
 
-			ac = &arcList[first];
+static void
+clearBuckets (ps_solver *ps)
+{
+	memset (ps->bucketBits, 0, ps->bucketLevelStart[ps->numBucketLevels] * sizeof (unsigned long long));
+}
 
-			ac->from = &adjacencyList[from-1];
-			ac->to = &adjacencyList[to-1];
-            
-            
-            tmpline = getNextWord (tmpline, word);
-			ac->capacity = (double) atof (word);
-            ac->base_capacity = ac->capacity;
-            
-            initEdgeList[first].from = from;
-            initEdgeList[first].to = to;
-            initEdgeList[first].capacity = ac->capacity;
+static void
+addToStrongBucket (ps_solver *ps, Node *newRoot) 
+{
+	Node *rootEnd = ps->strongRoots[newRoot->label].end;
 
-			++ first;
+	if (rootEnd->prev == ps->strongRoots[newRoot->label].start)
+	{
+		markBucket (ps, newRoot->label);
+	}
 
-			++ ac->from->numAdjacent;
-			++ ac->to->numAdjacent;
+	newRoot->next = rootEnd;
+	newRoot->prev = rootEnd->prev;
+	rootEnd->prev = newRoot;
+	newRoot->prev->next = newRoot;
+}
 
-			break;
+static inline void
+removeStrongRoot (ps_solver *ps, Node *strongRoot, const int label) 
+{
+	strongRoot->next->prev = strongRoot->prev;
+	strongRoot->prev->next = strongRoot->next;
 
-		case 'n':
+	if (ps->strongRoots[label].start->next == ps->strongRoots[label].end)
+	{
+		unmarkBucket (ps, label);
+	}
+}
 
-			sscanf (line, "%c %d %c", &ch, &i, &ch1);
+/* All out-of-tree lists share one block: node i owns numAdjacent slots starting where
+   node i-1's end. The lists hold arc indices and only ever shrink by swapping the last
+   entry into the freed slot, so a node never needs more room than its degree. */
+static void
+createOutOfTree (ps_solver *ps)
+{
+	int i;
+	llint offset = 0;
 
-			if (ch1 == 's')
-			{
-				source = i;	
-			}
-			else if (ch1 == 't')
-			{
-				sink = i;	
-			}
-			else
-			{
-				printf ("Unrecognized character %c on line %d\n", ch1, numLines);
-				exit (1);
-			}
+	if ((ps->outOfTreeSpace = (ArcIndex *) malloc ((2*ps->numArcs + 1) * sizeof (ArcIndex))) == NULL)
+	{
+		printf ("%s Line %d: Out of memory\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-			break;
-		}
+	for (i=0; i<ps->numNodes; ++i)
+	{
+		ps->adjacencyList[i].outOfTree = &ps->outOfTreeSpace[offset];
+		offset += ps->coldList[i].numAdjacent;
+	}
+}
+
+static void
+initializeArc (Arc *ac)
+{
+	//int i;
+
+	ac->from = 0;
+	ac->to = 0;
+	ac->capacity = 0;
+	ac->flow = 0;
+	ac->direction = 1;
+	ac->rescanLabel = 0;
+}
+
+static void
+addOutOfTreeNode (ps_solver *ps, Node *n, Arc *out) 
+{
+	out->rescanLabel = 0;
+	n->outOfTree[n->numOutOfTree] = out - ps->arcList;
+	++ n->numOutOfTree;
+}
+
+static Topology *
+createTopology (void)
+{
+	Topology *graph;
+
+	if ((graph = (Topology *) calloc (1, sizeof (Topology))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	graph->refCount = 1;
+
+	return graph;
+}
+
+static void
+releaseTopology (Topology *graph)
+{
+	if ((graph == NULL) || (__sync_sub_and_fetch (&graph->refCount, 1) > 0))
+	{
+		return;
 	}
 
-	for (i=0; i<numNodes; ++i) 
+	if (graph->mapping)
 	{
-		createOutOfTree (&adjacencyList[i]);
+		munmap (graph->mapping, graph->mappingSize);
 	}
+	else
+	{
+		free (graph->first);
+		free (graph->tails);
+		free (graph->heads);
+		free (graph->capacities);
+	}
+
+	free (graph);
+}
+
+static void
+attachTopology (ps_solver *ps, Topology *graph)
+{
+	ps->graph = graph;
+	ps->numNodes = graph->numNodes;
+	ps->numArcs = graph->numArcs;
+	ps->source = graph->source;
+	ps->sink = graph->sink;
+}
+
+/* Fills the out-of-tree arrays in arc order, as the pseudoflow phase expects
+   them at the start of a solve. */
+static void
+distributeArcs (ps_solver *ps)
+{
+	llint i;
+	int from, to;
+	Capacity capacity;
 
-	for (i=0; i<numArcs; i++) 
+	for (i=0; i<ps->numArcs; i++) 
 	{
-		to = arcList[i].to->number;
-		from = arcList[i].from->number;
-		capacity = arcList[i].capacity;
+		to = ps->arcList[i].to + 1;
+		from = ps->arcList[i].from + 1;
+		capacity = ps->arcList[i].capacity;
 
-		if (!((source == to) || (sink == from) || (from == to))) 
+		if (!((ps->source == to) || (ps->sink == from) || (from == to))) 
 		{
-			if ((source == from) && (to == sink)) 
+			if ((ps->source == from) && (to == ps->sink)) 
 			{
-				arcList[i].flow = capacity;
+				ps->arcList[i].flow = capacity;
 			}
-			else if (from == source)
+			else if (from == ps->source)
 			{
-				addOutOfTreeNode (&adjacencyList[from-1], &arcList[i]);
+				addOutOfTreeNode (ps, &ps->adjacencyList[from-1], &ps->arcList[i]);
 			}
-			else if (to == sink)
+			else if (to == ps->sink)
 			{
-				addOutOfTreeNode (&adjacencyList[to-1], &arcList[i]);
+				addOutOfTreeNode (ps, &ps->adjacencyList[to-1], &ps->arcList[i]);
 			}
 			else
 			{
-				addOutOfTreeNode (&adjacencyList[from-1], &arcList[i]);
+				addOutOfTreeNode (ps, &ps->adjacencyList[from-1], &ps->arcList[i]);
 			}
 		}
 	}
-
-	free (line);
-	line = NULL;
-
-	free (word);
-	word = NULL;
-    fclose(file);
 }
 
+/* Arcs between two inner nodes go to both ends' incidence lists, with their capacity,
+   which only the source- and sink-adjacent arcs ever change; those go to the terminal
+   list of their inner end, source-sink arcs to the sink's. Arcs into the source, out
+   of the sink and loops never cross the cut and are left out. */
 static void
-simpleInitialization (void) 
+createIncidence (ps_solver *ps)
 {
-	int i, size;
-	Arc *tempArc;
+	llint i;
+	int from, to, pass;
+	Arc *ac;
 
-	size = adjacencyList[source-1].numOutOfTree;
-	for (i=0; i<size; ++i) 
+	if (((ps->firstIncident = (llint *) calloc (ps->numNodes + 1, sizeof (llint))) == NULL) ||
+		((ps->firstTerminal = (ArcIndex *) calloc (ps->numNodes + 1, sizeof (ArcIndex))) == NULL))
 	{
-		tempArc = adjacencyList[source-1].outOfTree[i];
-		tempArc->flow = tempArc->capacity;
-		tempArc->to->excess += tempArc->capacity;
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
 	}
 
-	size = adjacencyList[sink-1].numOutOfTree;
-	for (i=0; i<size; ++i)
+	// The first pass counts the list lengths, the second one fills the lists.
+	for (pass=0; pass<2; ++pass)
 	{
-		tempArc = adjacencyList[sink-1].outOfTree[i];
-		tempArc->flow = tempArc->capacity;
-		tempArc->from->excess -= tempArc->capacity;
-	}
+		for (i=0; i<ps->numArcs; ++i)
+		{
+			ac = &ps->arcList[i];
+			from = ac->from;
+			to = ac->to;
 
-	adjacencyList[source-1].excess = 0;
-	adjacencyList[sink-1].excess = 0;
+			if ((from == to) || (ac->to == (ps->source-1)) || (ac->from == (ps->sink-1)))
+			{
+				continue;
+			}
 
-	for (i=0; i<numNodes; ++i) 
-	{
-		if (adjacencyList[i].excess > 0)
-        //if (adjacencyList[i].excess > EPSILON) 
+			if (ac->from == (ps->source-1))
+			{
+				if (pass)
+				{
+					ps->terminal[ps->firstTerminal[to]++] = ac;
+				}
+				else
+				{
+					++ ps->firstTerminal[to+1];
+				}
+			}
+			else if (ac->to == (ps->sink-1))
+			{
+				if (pass)
+				{
+					ps->terminal[ps->firstTerminal[from]++] = ac;
+				}
+				else
+				{
+					++ ps->firstTerminal[from+1];
+				}
+			}
+			else if (pass)
+			{
+				ps->incident[ps->firstIncident[from]].capacity = ac->capacity;
+				ps->incident[ps->firstIncident[from]].other = to;
+				ps->incident[ps->firstIncident[from]++].outgoing = 1;
+				ps->incident[ps->firstIncident[to]].capacity = ac->capacity;
+				ps->incident[ps->firstIncident[to]].other = from;
+				ps->incident[ps->firstIncident[to]++].outgoing = 0;
+			}
+			else
+			{
+				++ ps->firstIncident[from+1];
+				++ ps->firstIncident[to+1];
+			}
+		}
+
+		if (pass)
+		{
+			break;
+		}
+
+		for (i=0; i<ps->numNodes; ++i)
 		{
-		    adjacencyList[i].label = 1;
-			++ labelCount[1];
+			ps->firstIncident[i+1] += ps->firstIncident[i];
+			ps->firstTerminal[i+1] += ps->firstTerminal[i];
+		}
 
-			addToStrongBucket (&adjacencyList[i], strongRoots[1].end);
+		if (((ps->incident = (Incidence *) malloc ((ps->firstIncident[ps->numNodes] + 1) * sizeof (Incidence))) == NULL) ||
+			((ps->terminal = (Arc **) malloc ((ps->firstTerminal[ps->numNodes] + 1) * sizeof (Arc *))) == NULL))
+		{
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
 		}
 	}
 
-	adjacencyList[source-1].label = numNodes;
-	adjacencyList[sink-1].label = 0;
-	labelCount[0] = (numNodes - 2) - labelCount[1];
+	// Filling advanced every start to the start of the next list.
+	for (i=ps->numNodes; i>0; --i)
+	{
+		ps->firstIncident[i] = ps->firstIncident[i-1];
+		ps->firstTerminal[i] = ps->firstTerminal[i-1];
+	}
+	ps->firstIncident[0] = 0;
+	ps->firstTerminal[0] = 0;
 }
 
+/* Fills newIndex (topology node - 1 to solver node) and oldIndex (its inverse). With
+   renumbering on, the nodes are laid out in breadth-first order over the inner arcs, so
+   that similar edges and their endpoints sit close together in adjacencyList. Every node
+   only moves to a position held by a node of its own kind (edge-vertex, node-vertex), and
+   the source, the sink and the auxiliaries stay put: the index ranges the solver relies
+   on are the same in both numberings. */
 static void
-reInitialization_negative (double lambda, double initial_guess) 
+createRenumbering (ps_solver *ps)
 {
-	int i, size;
-	Arc *tempArc, *ac;
-    Node *nd;    
-    
-    for (i=0; i<numNodes; ++i)
+	llint i;
+	int v, w, head, tail, n = ps->numNodes;
+	int *adjacent, *queue, cursor[3];
+	llint j, *first;
+	char *kind, *seen;
+	const int *tails = ps->graph->tails, *heads = ps->graph->heads;
+
+	if (((ps->newIndex = (int *) malloc (n * sizeof (int))) == NULL) ||
+		((ps->oldIndex = (int *) malloc (n * sizeof (int))) == NULL))
 	{
-		initializeRoot (&strongRoots[i]);
-        
-        nd = &adjacencyList[i];    
-        nd->label = 0;
-        nd->excess = 0;
-        nd->parent = NULL;
-        nd->childList = NULL;
-        nd->nextScan = NULL;
-        nd->nextArc = 0;
-        //nd->numOutOfTree = 0;
-        nd->arcToParent = NULL;
-        nd->next = NULL;
-        nd->prev = NULL;
-        nd->visited = 0; 
-		
-		labelCount[i] = 0;
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
 	}
 
-	for (i=0; i<numArcs; ++i)
+	for (i=0; i<n; ++i)
 	{
-		ac = &arcList[i];    
-        ac->flow = 0;
-        ac->direction = 1;
+		ps->newIndex[i] = i;
+		ps->oldIndex[i] = i;
 	}
-    
-     
-	size = adjacencyList[source-1].numOutOfTree;
-	for (i=0; i<size; ++i) 
+
+	if (!ps->renumber)
 	{
-		tempArc = adjacencyList[source-1].outOfTree[i];
-        tempArc->capacity = lambda;
-		tempArc->flow = tempArc->capacity;
-		tempArc->to->excess += tempArc->capacity;
-        printf ("c Reinit: source-adjacent arc (%d, %d): capacity %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity);
+		return;
 	}
 
-	size = adjacencyList[sink-1].numOutOfTree;
-	for (i=0; i<size; ++i)
+	if (((first = (llint *) calloc (n + 1, sizeof (llint))) == NULL) ||
+		((adjacent = (int *) malloc ((2*(llint)ps->numArcs + 1) * sizeof (int))) == NULL) ||
+		((queue = (int *) malloc (n * sizeof (int))) == NULL) ||
+		((kind = (char *) calloc (n, sizeof (char))) == NULL) ||
+		((seen = (char *) calloc (n, sizeof (char))) == NULL))
 	{
-		tempArc = adjacencyList[sink-1].outOfTree[i];
-        tempArc->capacity = tempArc->base_capacity - initial_guess;
-		tempArc->flow = tempArc->capacity;
-		tempArc->from->excess -= tempArc->capacity;
-        printf ("c Reinit: sink-adjacent arc (%d, %d): capacity %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity);
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
 	}
 
-	adjacencyList[source-1].excess = 0;
-	adjacencyList[sink-1].excess = 0;
+	// kind 0 stays put, kind 1 is an edge-vertex, kind 2 any other inner node.
+	for (i=0; i<n; ++i)
+	{
+		kind[i] = ((i == (ps->source-1)) || (i == (ps->sink-1)) || isAuxiliary (ps, i+1)) ? 0 : 2;
+	}
 
-	for (i=0; i<numNodes; ++i) 
+	for (i=0; i<ps->numArcs; ++i)
 	{
-		if (adjacencyList[i].excess > 0) 
+		v = tails[i]-1;
+		w = heads[i]-1;
+		if ((w == (ps->sink-1)) && kind[v])
 		{
-		    adjacencyList[i].label = 1;
-			++ labelCount[1];
-
-			addToStrongBucket (&adjacencyList[i], strongRoots[1].end);
+			kind[v] = 1;
+		}
+		else if ((v != w) && (v != (ps->source-1)) && (v != (ps->sink-1)) &&
+			(w != (ps->source-1)) && (w != (ps->sink-1)))
+		{
+			++ first[v+1];
+			++ first[w+1];
 		}
 	}
 
-	adjacencyList[source-1].label = numNodes;
-	adjacencyList[sink-1].label = 0;
-	labelCount[0] = (numNodes - 2) - labelCount[1];
-}
-
-static void
-reInitialization (double lambda, double initial_guess, int num_edges) 
-{
-	int i, size;
-	Arc *tempArc, *ac;
-    Node *nd;    
-    
-    for (i=0; i<numNodes; ++i)
+	for (i=0; i<n; ++i)
 	{
-		initializeRoot (&strongRoots[i]);
-        
-        nd = &adjacencyList[i];    
-        nd->label = 0;
-        nd->excess = 0;
-        nd->parent = NULL;
-        nd->childList = NULL;
-        nd->nextScan = NULL;
-        nd->nextArc = 0;
-        nd->arcToParent = NULL;
-        nd->next = NULL;
-        nd->prev = NULL;
-        nd->visited = 0;
-		
-		labelCount[i] = 0;
+		first[i+1] += first[i];
 	}
 
-	for (i=0; i<numArcs; ++i)
+	for (i=0; i<ps->numArcs; ++i)
 	{
-		ac = &arcList[i];    
-        ac->flow = 0;
-        ac->direction = 1;
+		v = tails[i]-1;
+		w = heads[i]-1;
+		if ((v != w) && (v != (ps->source-1)) && (v != (ps->sink-1)) &&
+			(w != (ps->source-1)) && (w != (ps->sink-1)))
+		{
+			adjacent[first[v]++] = w;
+			adjacent[first[w]++] = v;
+		}
 	}
-    
-     
-	size = adjacencyList[source-1].numOutOfTree;
-	for (i=0; i<size; ++i) 
+
+	for (i=n; i>0; --i)
 	{
-		tempArc = adjacencyList[source-1].outOfTree[i];
-        if (tempArc->to->number <= num_edges) {
-            tempArc->capacity = initial_guess;
-        } else {
-            tempArc->capacity = lambda;
-        }
-		tempArc->flow = tempArc->capacity;
-		tempArc->to->excess += tempArc->capacity;
-        printf ("c Reinit: source-adjacent arc (%d, %d): capacity %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity);
+		first[i] = first[i-1];
 	}
-
-	size = adjacencyList[sink-1].numOutOfTree;
-	for (i=0; i<size; ++i)
+	first[0] = 0;
+
+	// Breadth-first search from every node not reached yet; auxiliaries are passed
+	// through but keep their positions. cursor[k] is the next free position of kind k.
+	cursor[1] = 0;
+	cursor[2] = 0;
+	tail = 0;
+	for (i=0; i<n; ++i)
 	{
-		tempArc = adjacencyList[sink-1].outOfTree[i];
-		tempArc->flow = tempArc->capacity;
-		tempArc->from->excess -= tempArc->capacity;
-        printf ("c Reinit: sink-adjacent arc (%d, %d): capacity %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity);
-	}
+		if (seen[i] || (kind[i] == 0))
+		{
+			continue;
+		}
 
-	adjacencyList[source-1].excess = 0;
-	adjacencyList[sink-1].excess = 0;
+		head = tail;
+		queue[tail++] = i;
+		seen[i] = 1;
 
-	for (i=0; i<numNodes; ++i) 
-	{
-		if (adjacencyList[i].excess > 0)
+		while (head < tail)
 		{
-		    adjacencyList[i].label = 1;
-			++ labelCount[1];
+			v = queue[head++];
 
-			addToStrongBucket (&adjacencyList[i], strongRoots[1].end);
+			if (kind[v])
+			{
+				while (kind[cursor[(int) kind[v]]] != kind[v])
+				{
+					++ cursor[(int) kind[v]];
+				}
+				ps->newIndex[v] = cursor[(int) kind[v]]++;
+			}
+
+			for (j=first[v]; j<first[v+1]; ++j)
+			{
+				w = adjacent[j];
+				if (!seen[w])
+				{
+					queue[tail++] = w;
+					seen[w] = 1;
+				}
+			}
 		}
 	}
 
-	adjacencyList[source-1].label = numNodes;
-	adjacencyList[sink-1].label = 0;
-	labelCount[0] = (numNodes - 2) - labelCount[1];
+	for (i=0; i<n; ++i)
+	{
+		ps->oldIndex[ps->newIndex[i]] = i;
+	}
+
+	free (first);
+	free (adjacent);
+	free (queue);
+	free (kind);
+	free (seen);
 }
 
-static inline int 
-addRelationship (Node *newParent, Node *child) 
+static void
+createGraph (ps_solver *ps) 
 {
-	child->parent = newParent;
-	child->next = newParent->childList;
-	newParent->childList = child;
+	llint i;
+	int from, to;
+	Arc *ac = NULL;
 
-	return 0;
-}
 
-static inline void
-breakRelationship (Node *oldParent, Node *child) 
-{
-	Node *current;
+	if ((ps->adjacencyList = (Node *) malloc (ps->numNodes * sizeof (Node))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-	child->parent = NULL;
+	if ((ps->coldList = (ColdNode *) calloc (ps->numNodes, sizeof (ColdNode))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-	if (oldParent->childList == child) 
+	if ((ps->strongRoots = (Root *) malloc (ps->numNodes * sizeof (Root))) == NULL)
 	{
-		oldParent->childList = child->next;
-		child->next = NULL;
-		return;
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
 	}
 
-	for (current = oldParent->childList; (current->next != child); current = current->next);
+	if ((ps->rootSentinels = (Node *) malloc (2 * ps->numNodes * sizeof (Node))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-	current->next = child->next;
-	child->next = NULL;
-}
+	ps->bucketLevelStart[0] = 0;
+	ps->numBucketLevels = 0;
+	i = ps->numNodes;
+	do
+	{
+		i = (i + 63) / 64;
+		ps->bucketLevelStart[ps->numBucketLevels+1] = ps->bucketLevelStart[ps->numBucketLevels] + i;
+		++ ps->numBucketLevels;
+	} while (i > 1);
 
-static void
-merge (Node *parent, Node *child, Arc *newArc) 
-{
-	Arc *oldArc;
-	Node *current = child, *oldParent, *newParent = parent;
+	if ((ps->bucketBits = (unsigned long long *) calloc (ps->bucketLevelStart[ps->numBucketLevels], sizeof (unsigned long long))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-#ifdef STATS
-	++ numMergers;
-#endif
+	if ((ps->labelCount = (int *) malloc (ps->numNodes * sizeof (int))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
 
-	while (current->parent) 
+	if ((ps->arcList = (Arc *) malloc (ps->numArcs * sizeof (Arc))) == NULL)
 	{
-		oldArc = current->arcToParent;
-		current->arcToParent = newArc;
-		oldParent = current->parent;
-		breakRelationship (oldParent, current);
-		addRelationship (newParent, current);
-		newParent = current;
-		current = oldParent;
-		newArc = oldArc;
-		newArc->direction = 1 - newArc->direction;
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+          
+	for (i=0; i<ps->numNodes; ++i)
+	{
+		initializeRoot (&ps->strongRoots[i], &ps->rootSentinels[2*i]);
+		initializeNode (&ps->adjacencyList[i], (i+1));
+		ps->labelCount[i] = 0;
 	}
 
-	current->arcToParent = newArc;
-	addRelationship (newParent, current);
-}
+	for (i=0; i<ps->numArcs; ++i)
+	{
+		initializeArc (&ps->arcList[i]);
+	}
 
+	createRenumbering (ps);
 
-static inline void 
-pushUpward (Arc *currentArc, Node *child, Node *parent, const double resCap) 
-{
-#ifdef STATS
-	++ numPushes;
-#endif
+    for (i=0; i<ps->numArcs; ++i)
+    {
+        ac = &ps->arcList[i];
 
-	if (resCap >= child->excess) 
+        ac->from = ps->newIndex[ps->graph->tails[i]-1];
+        ac->to = ps->newIndex[ps->graph->heads[i]-1];
+        ac->capacity = toCapacity (ps, ps->graph->capacities[i]);
+
+        ++ ps->coldList[ac->from].numAdjacent;
+        ++ ps->coldList[ac->to].numAdjacent;
+    }
+
+	createIncidence (ps);
+
+	createOutOfTree (ps);
+
+	ps->numEdges = 0;
+	ps->numAuxiliary = ps->numNodes - ((ps->source > ps->sink) ? ps->source : ps->sink);
+	for (i=0; i<ps->numArcs; i++) 
 	{
-		parent->excess += child->excess;
-		currentArc->flow += child->excess;
-		child->excess = 0;
-		return;
-	}
+		to = ps->arcList[i].to + 1;
+		from = ps->arcList[i].from + 1;
 
-	currentArc->direction = 0;
-	parent->excess += resCap;
-	child->excess -= resCap;
-	currentArc->flow = currentArc->capacity;
-	parent->outOfTree[parent->numOutOfTree] = currentArc;
-	++ parent->numOutOfTree;
-	breakRelationship (parent, child);
+		if ((to == ps->sink) && (from != ps->source) && !isAuxiliary (ps, from))
+		{
+			++ ps->numEdges;
+		}
+	}
 
-	addToStrongBucket (child, strongRoots[child->label].end);
+	distributeArcs (ps);
 }
 
-
-static inline void
-pushDownward (Arc *currentArc, Node *child, Node *parent, double flow) 
+/* Puts the solver back into the state createGraph leaves it in. The nodes, roots,
+   arcs and out-of-tree arrays are reused; only their contents are rewritten. */
+static void
+resetGraph (ps_solver *ps)
 {
-#ifdef STATS
-	++ numPushes;
-#endif
+	llint i;
+	Node *nd;
+	Arc *ac;
 
-	if (flow >= child->excess) 
+	clearBuckets (ps);
+	for (i=0; i<ps->numNodes; ++i)
 	{
-		parent->excess += child->excess;
-		currentArc->flow -= child->excess;
-		child->excess = 0;
-		return;
+		nd = &ps->adjacencyList[i];
+		nd->label = 0;
+		nd->excess = 0;
+		nd->parent = NULL;
+		nd->childList = NULL;
+		nd->nextScan = NULL;
+		nd->nextArc = 0;
+		nd->numOutOfTree = 0;
+		nd->arcToParent = NULL;
+		nd->next = NULL;
+		nd->prev = NULL;
+		ps->coldList[i].visited = 0;
+		ps->coldList[i].breakpoint = 0;
+
+		emptyRoot (&ps->strongRoots[i]);
+		ps->labelCount[i] = 0;
 	}
 
-	currentArc->direction = 1;
-	child->excess -= flow;
-	parent->excess += flow;
-	currentArc->flow = 0;
-	parent->outOfTree[parent->numOutOfTree] = currentArc;
-	++ parent->numOutOfTree;
-	breakRelationship (parent, child);
+	for (i=0; i<ps->numArcs; ++i)
+	{
+		ac = &ps->arcList[i];
+		ac->capacity = baseCapacity (ps, ac);
+		ac->flow = 0;
+		ac->direction = 1;
+		ac->rescanLabel = 0;
+	}
 
-	addToStrongBucket (child, strongRoots[child->label].end);
+	distributeArcs (ps);
 }
 
 static void
-pushExcess (Node *strongRoot) 
+reCreateGraph (ps_solver *ps, const int num_edges, const double lambda, const double c) 
 {
-	Node *current, *parent;
-	Arc *arcToParent;
+	int i, size;
+	Capacity edgeCapacity, nodeCapacity;
+	Arc *ac;
 
-	for (current = strongRoot; (current->excess && current->parent); current = parent) 
+	if (ps->adjacencyList == NULL)
 	{
-		parent = current->parent;
-		arcToParent = current->arcToParent;
-		if (arcToParent->direction)
+		createGraph (ps);
+	}
+	else
+	{
+		resetGraph (ps);
+	}
+
+	edgeCapacity = toCapacity (ps, c);
+	nodeCapacity = toCapacity (ps, lambda);
+
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		ac = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+		if (ac->to < num_edges)
 		{
-			pushUpward (arcToParent, current, parent, (arcToParent->capacity - arcToParent->flow)); 
+			ac->capacity = edgeCapacity;
 		}
 		else
 		{
-			pushDownward (arcToParent, current, parent, arcToParent->flow); 
+			ac->capacity = nodeCapacity;
 		}
 	}
+}
 
-	if (current->excess > 0)
-    //if (current->excess > EPSILON) 
+
+typedef struct dimacsChunk
+{
+	const char *start;
+	const char *end;
+	Topology *graph;
+	llint firstLine;
+	llint numLines;
+	llint firstArc;
+	llint numArcs;
+	int source;
+	int sink;
+	llint errorLine;
+	const char *errorMessage;
+} DimacsChunk;
+
+static void *
+countDimacsChunk (void *arg)
+{
+	DimacsChunk *chunk = (DimacsChunk *) arg;
+	const char *pos;
+
+	chunk->numLines = 0;
+	chunk->numArcs = 0;
+
+	for (pos = chunk->start; pos < chunk->end; pos = nextLine (pos, chunk->end))
 	{
-		if (!current->next)
+		++ chunk->numLines;
+		if ((*pos) == 'a')
 		{
-			addToStrongBucket (current, strongRoots[current->label].end);
+			++ chunk->numArcs;
 		}
 	}
+
+	return NULL;
 }
 
+static void *
+parseDimacsChunk (void *arg)
+{
+	DimacsChunk *chunk = (DimacsChunk *) arg;
+	Topology *graph = chunk->graph;
+	const char *pos, *field, *end = chunk->end;
+	llint line = chunk->firstLine, arc = chunk->firstArc;
+	int from, to, id;
+	double capacity;
+
+	for (pos = chunk->start; pos < end; pos = nextLine (pos, end), ++ line)
+	{
+		switch (*pos)
+		{
+		case 'a':
 
-static Arc *
-findWeakNode (Node *strongNode, Node **weakNode) 
+			if (((field = parseInt (pos+1, end, &from)) == NULL) ||
+				((field = parseInt (field, end, &to)) == NULL) ||
+				((field = parseDouble (field, end, &capacity)) == NULL) ||
+				(((field = skipBlanks (field, end)) < end) && ((*field) != '\n')))
+			{
+				chunk->errorMessage = "malformed arc line";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			// Also rejects nan and inf; infinite arcs are written as 1.79769e+308.
+			if (!((capacity >= 0) && (capacity <= DBL_MAX)))
+			{
+				chunk->errorMessage = "arc capacity negative or not finite";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			if ((from < 1) || (from > graph->numNodes) || (to < 1) || (to > graph->numNodes))
+			{
+				chunk->errorMessage = "arc endpoint out of range";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			graph->tails[arc] = from;
+			graph->heads[arc] = to;
+			graph->capacities[arc] = capacity;
+			++ arc;
+
+			break;
+
+		case 'n':
+
+			if ((field = parseInt (pos+1, end, &id)) == NULL)
+			{
+				chunk->errorMessage = "malformed node line";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			field = skipBlanks (field, end);
+
+			if ((field < end) && ((*field) == 's'))
+			{
+				chunk->source = id;
+			}
+			else if ((field < end) && ((*field) == 't'))
+			{
+				chunk->sink = id;
+			}
+			else
+			{
+				chunk->errorMessage = "unrecognized node designator";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			break;
+
+		case 'p':
+
+			chunk->errorMessage = "duplicate problem line";
+			chunk->errorLine = line;
+			return NULL;
+
+		default:
+
+			if (!isCommentLine (pos, end))
+			{
+				chunk->errorMessage = "unknown line type";
+				chunk->errorLine = line;
+				return NULL;
+			}
+
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+dimacsError (const char *filename, const llint line, const char *message)
 {
-	int i, size;
-	Arc *out;
+	printf ("%s, line %lld: %s\n", filename, line, message);
+	exit (1);
+}
 
-	size = strongNode->numOutOfTree;
+/* Maps the file and parses it in newline-aligned chunks, one per thread: a
+   counting pass fixes each chunk's first arc and line number, then every
+   chunk writes its arcs straight into the topology arrays. */
+static void
+readDimacsFileCreateList (ps_solver *ps, const char *filename)
+{
+	Topology *graph = createTopology ();
+	DimacsChunk *chunks;
+	pthread_t *threads;
+	struct stat st;
+	const char *base, *end, *pos, *field;
+	int fd, i, numChunks, errorChunk = -1;
+	llint numLines = 0, numArcs = 0;
+	char word[16];
 
-	for (i=strongNode->nextArc; i<size; ++i) 
+    printf ("Read filename %s\n", filename);
+
+	if (((fd = open (filename, O_RDONLY)) < 0) || (fstat (fd, &st) < 0))
 	{
+		printf ("%s, %d: Could not open %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
 
-#ifdef STATS
-		++ numArcScans;
-#endif
+	if (st.st_size == 0)
+	{
+		dimacsError (filename, 0, "empty file");
+	}
 
-		if (strongNode->outOfTree[i]->to->label == (highestStrongLabel-1)) 
-		{
-			strongNode->nextArc = i;
-			out = strongNode->outOfTree[i];
-			(*weakNode) = out->to;
-			-- strongNode->numOutOfTree;
-			strongNode->outOfTree[i] = strongNode->outOfTree[strongNode->numOutOfTree];
-			return (out);
-		}
-		else if (strongNode->outOfTree[i]->from->label == (highestStrongLabel-1)) 
+	if ((base = (const char *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+	{
+		printf ("%s, %d: Could not map %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+	close (fd);
+	madvise ((void *) base, st.st_size, MADV_SEQUENTIAL);
+	end = base + st.st_size;
+
+	for (pos = base; (pos < end) && ((*pos) != 'p'); pos = nextLine (pos, end))
+	{
+		++ numLines;
+		if (!isCommentLine (pos, end))
 		{
-			strongNode->nextArc = i;
-			out = strongNode->outOfTree[i];
-			(*weakNode) = out->from;
-			-- strongNode->numOutOfTree;
-			strongNode->outOfTree[i] = strongNode->outOfTree[strongNode->numOutOfTree];
-			return (out);
+			dimacsError (filename, numLines, "unknown line type");
 		}
 	}
+	++ numLines;
+
+	if (pos == end)
+	{
+		dimacsError (filename, numLines, "missing problem line");
+	}
+
+	field = skipBlanks (pos+1, end);
+	for (i=0; (field < end) && (i < (int) sizeof (word) - 1) && ((*field) != ' ') && ((*field) != '\t'); ++ field, ++ i)
+	{
+		word[i] = (*field);
+	}
+	word[i] = '\0';
+
+	if (((field = parseInt (field, end, &graph->numNodes)) == NULL) ||
+		((field = parseLong (field, end, &graph->numArcs)) == NULL) ||
+		(graph->numNodes < 2) || (graph->numArcs < 0))
+	{
+		dimacsError (filename, numLines, "malformed problem line");
+	}
+
+	if (graph->numArcs > MAX_ARC_INDEX / 2)
+	{
+		dimacsError (filename, numLines, "too many arcs for 32-bit arc indices, rebuild with -DLARGE_GRAPHS");
+	}
+
+#ifdef VERBOSE
+	printf ("%s numNodes: %d, numArcs: %lld\n", word, graph->numNodes, graph->numArcs);
+#endif
+
+	if (((graph->tails = (int *) malloc (graph->numArcs * sizeof (int))) == NULL) ||
+		((graph->heads = (int *) malloc (graph->numArcs * sizeof (int))) == NULL) ||
+		((graph->capacities = (double *) malloc (graph->numArcs * sizeof (double))) == NULL))
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	pos = nextLine (pos, end);
+
+	numChunks = (int) sysconf (_SC_NPROCESSORS_ONLN);
+	if ((end - pos) / DIMACS_CHUNK_SIZE + 1 < numChunks)
+	{
+		numChunks = (int) ((end - pos) / DIMACS_CHUNK_SIZE + 1);
+	}
+	if (numChunks < 1)
+	{
+		numChunks = 1;
+	}
+
+	if (((chunks = (DimacsChunk *) calloc (numChunks, sizeof (DimacsChunk))) == NULL) ||
+		((threads = (pthread_t *) malloc (numChunks * sizeof (pthread_t))) == NULL))
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	for (i=0; i<numChunks; ++i)
+	{
+		chunks[i].graph = graph;
+		chunks[i].start = (i == 0) ? pos : chunks[i-1].end;
+		chunks[i].end = (i == numChunks-1) ? end : nextLine (pos + (end - pos) / numChunks * (i+1), end);
+		if (chunks[i].end < chunks[i].start)
+		{
+			chunks[i].end = chunks[i].start;
+		}
+		pthread_create (&threads[i], NULL, countDimacsChunk, &chunks[i]);
+	}
+
+	for (i=0; i<numChunks; ++i)
+	{
+		pthread_join (threads[i], NULL);
+		chunks[i].firstLine = numLines + 1;
+		chunks[i].firstArc = numArcs;
+		numLines += chunks[i].numLines;
+		numArcs += chunks[i].numArcs;
+	}
+
+	if (numArcs != graph->numArcs)
+	{
+		printf ("%s: problem line declares %lld arcs, file has %lld\n", filename, graph->numArcs, numArcs);
+		exit (1);
+	}
+
+	for (i=0; i<numChunks; ++i)
+	{
+		pthread_create (&threads[i], NULL, parseDimacsChunk, &chunks[i]);
+	}
+
+	for (i=0; i<numChunks; ++i)
+	{
+		pthread_join (threads[i], NULL);
+
+		if ((chunks[i].errorLine) && (errorChunk < 0))
+		{
+			errorChunk = i;
+		}
+		if (chunks[i].source)
+		{
+			graph->source = chunks[i].source;
+		}
+		if (chunks[i].sink)
+		{
+			graph->sink = chunks[i].sink;
+		}
+	}
+
+	if (errorChunk >= 0)
+	{
+		dimacsError (filename, chunks[errorChunk].errorLine, chunks[errorChunk].errorMessage);
+	}
+
+	if ((graph->source < 1) || (graph->source > graph->numNodes) || (graph->sink < 1) || (graph->sink > graph->numNodes))
+	{
+		dimacsError (filename, numLines, "missing or invalid source/sink designation");
+	}
+
+	munmap ((void *) base, st.st_size);
+	free (chunks);
+	free (threads);
+
+	attachTopology (ps, graph);
+	createGraph (ps);
+}
+
+/* The mapped arrays are used as they are, so every offset and node id is
+   checked before the solver indexes with it: the offsets must start at zero,
+   never decrease and end at numArcs, and each arc must lie in its tail's range. */
+static void
+checkBinaryArcs (const Topology *graph, const char *filename)
+{
+	llint j;
+	int i;
+
+	if ((graph->first[0] != 0) || (graph->first[graph->numNodes] != graph->numArcs))
+	{
+		printf ("%s, %d: %s: arc offsets do not span the %lld arcs.\n", __FILE__, __LINE__, filename, graph->numArcs);
+		exit (1);
+	}
+
+	for (i=1; i<=graph->numNodes; ++i)
+	{
+		if ((graph->first[i] < graph->first[i-1]) || (graph->first[i] > graph->numArcs))
+		{
+			printf ("%s, %d: %s, node %d: arc offsets decrease or overrun.\n", __FILE__, __LINE__, filename, i);
+			exit (1);
+		}
+
+		for (j=graph->first[i-1]; j<graph->first[i]; ++j)
+		{
+			if (graph->tails[j] != i)
+			{
+				printf ("%s, %d: %s, arc %lld: tail does not match the arc offsets.\n", __FILE__, __LINE__, filename, j+1);
+				exit (1);
+			}
+
+			if ((graph->heads[j] < 1) || (graph->heads[j] > graph->numNodes))
+			{
+				printf ("%s, %d: %s, arc %lld: arc endpoint out of range.\n", __FILE__, __LINE__, filename, j+1);
+				exit (1);
+			}
+		}
+	}
+}
+
+static void
+readBinaryFileCreateList (ps_solver *ps, const char *filename) 
+{
+	MetagraphHeader *header;
+	Topology *graph;
+	struct stat st;
+	char *base;
+	size_t expected;
+	int fd;
+
+	printf ("Read filename %s\n", filename);
+
+	if (((fd = open (filename, O_RDONLY)) < 0) || (fstat (fd, &st) < 0))
+	{
+		printf ("%s, %d: Could not open %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+
+	if ((size_t) st.st_size < sizeof (MetagraphHeader))
+	{
+		printf ("%s, %d: %s is too short for a metagraph header.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+
+	if ((base = (char *) mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		printf ("%s, %d: Could not map %s.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+	close (fd);
+
+	header = (MetagraphHeader *) base;
+
+	if (memcmp (header->magic, METAGRAPH_MAGIC, sizeof (header->magic)) ||
+		(header->version != METAGRAPH_VERSION) || (header->headerSize < (int) sizeof (MetagraphHeader)))
+	{
+		printf ("%s, %d: %s is not a version %d metagraph.\n", __FILE__, __LINE__, filename, METAGRAPH_VERSION);
+		exit (1);
+	}
+
+	if ((header->numNodes < 2) || (header->numArcs < 0))
+	{
+		printf ("%s, %d: %s has an invalid header (%lld nodes, %lld arcs).\n", __FILE__, __LINE__, filename,
+			header->numNodes, header->numArcs);
+		exit (1);
+	}
+
+	if (header->numNodes > INT_MAX)
+	{
+		printf ("%s, %d: %s has more than %d nodes.\n", __FILE__, __LINE__, filename, INT_MAX);
+		exit (1);
+	}
+
+	if (header->numArcs > MAX_ARC_INDEX / 2)
+	{
+		printf ("%s, %d: %s has %lld arcs, too many for 32-bit arc indices; rebuild with -DLARGE_GRAPHS.\n",
+			__FILE__, __LINE__, filename, header->numArcs);
+		exit (1);
+	}
+
+	if ((header->source < 1) || (header->source > header->numNodes) || (header->sink < 1) || (header->sink > header->numNodes))
+	{
+		printf ("%s, %d: %s has an invalid source/sink designation.\n", __FILE__, __LINE__, filename);
+		exit (1);
+	}
+
+	expected = header->headerSize + (header->numNodes+1) * sizeof (llint) +
+		header->numArcs * (2*sizeof (int) + sizeof (double));
+
+	if ((size_t) st.st_size < expected)
+	{
+		printf ("%s, %d: %s is truncated (%lld of %lld bytes).\n", __FILE__, __LINE__, filename,
+			(llint) st.st_size, (llint) expected);
+		exit (1);
+	}
+
+	graph = createTopology ();
+	graph->mapping = base;
+	graph->mappingSize = st.st_size;
+	graph->numNodes = header->numNodes;
+	graph->numArcs = header->numArcs;
+	graph->source = header->source;
+	graph->sink = header->sink;
+	graph->first = (llint *) (base + header->headerSize);
+	graph->tails = (int *) (graph->first + graph->numNodes + 1);
+	graph->heads = graph->tails + graph->numArcs;
+	graph->capacities = (double *) (graph->heads + graph->numArcs);
+
+	checkBinaryArcs (graph, filename);
+
+	attachTopology (ps, graph);
+	createGraph (ps);
+}
+
+static void
+simpleInitialization (ps_solver *ps) 
+{
+	int i, size;
+	Arc *tempArc;
+
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->to].excess += tempArc->capacity;
+	}
+
+	size = ps->adjacencyList[ps->sink-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->from].excess -= tempArc->capacity;
+	}
+
+	ps->adjacencyList[ps->source-1].excess = 0;
+	ps->adjacencyList[ps->sink-1].excess = 0;
+
+	for (i=0; i<ps->numNodes; ++i) 
+	{
+		if (ps->adjacencyList[i].excess > 0)
+        //if (ps->adjacencyList[i].excess > EPSILON) 
+		{
+		    ps->adjacencyList[i].label = 1;
+			++ ps->labelCount[1];
+
+			addToStrongBucket (ps, &ps->adjacencyList[i]);
+		}
+	}
+
+	ps->adjacencyList[ps->source-1].label = ps->numNodes;
+	ps->adjacencyList[ps->sink-1].label = 0;
+	ps->labelCount[0] = (ps->numNodes - 2) - ps->labelCount[1];
+
+	countCut (ps);
+}
+
+static void
+reInitialization_negative (ps_solver *ps, double lambda, double initial_guess) 
+{
+	llint i;
+	int size;
+	Arc *tempArc, *ac;
+    Node *nd;    
+    
+    clearBuckets (ps);
+    for (i=0; i<ps->numNodes; ++i)
+	{
+		emptyRoot (&ps->strongRoots[i]);
+        
+        nd = &ps->adjacencyList[i];    
+        nd->label = 0;
+        nd->excess = 0;
+        nd->parent = NULL;
+        nd->childList = NULL;
+        nd->nextScan = NULL;
+        nd->nextArc = 0;
+        //nd->numOutOfTree = 0;
+        nd->arcToParent = NULL;
+        nd->next = NULL;
+        nd->prev = NULL;
+        ps->coldList[i].visited = 0; 
+		
+		ps->labelCount[i] = 0;
+	}
+
+	for (i=0; i<ps->numArcs; ++i)
+	{
+		ac = &ps->arcList[i];    
+        ac->flow = 0;
+        ac->direction = 1;
+        ac->rescanLabel = 0;
+	}
+    
+     
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+        tempArc->capacity = toCapacity (ps, lambda);
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->to].excess += tempArc->capacity;
+        printf ("c Reinit: source-adjacent arc (%d, %d): capacity %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity));
+	}
+
+	size = ps->adjacencyList[ps->sink-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];
+        tempArc->capacity = baseCapacity (ps, tempArc) - toCapacity (ps, initial_guess);
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->from].excess -= tempArc->capacity;
+        printf ("c Reinit: sink-adjacent arc (%d, %d): capacity %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity));
+	}
+
+	ps->adjacencyList[ps->source-1].excess = 0;
+	ps->adjacencyList[ps->sink-1].excess = 0;
+
+	for (i=0; i<ps->numNodes; ++i) 
+	{
+		if (ps->adjacencyList[i].excess > 0) 
+		{
+		    ps->adjacencyList[i].label = 1;
+			++ ps->labelCount[1];
+
+			addToStrongBucket (ps, &ps->adjacencyList[i]);
+		}
+	}
+
+	ps->adjacencyList[ps->source-1].label = ps->numNodes;
+	ps->adjacencyList[ps->sink-1].label = 0;
+	ps->labelCount[0] = (ps->numNodes - 2) - ps->labelCount[1];
+
+	countCut (ps);
+}
+
+static void
+reInitialization (ps_solver *ps, double lambda, double initial_guess, int num_edges) 
+{
+	llint i;
+	int size;
+	Arc *tempArc, *ac;
+    Node *nd;    
+    
+    clearBuckets (ps);
+    for (i=0; i<ps->numNodes; ++i)
+	{
+		emptyRoot (&ps->strongRoots[i]);
+        
+        nd = &ps->adjacencyList[i];    
+        nd->label = 0;
+        nd->excess = 0;
+        nd->parent = NULL;
+        nd->childList = NULL;
+        nd->nextScan = NULL;
+        nd->nextArc = 0;
+        nd->arcToParent = NULL;
+        nd->next = NULL;
+        nd->prev = NULL;
+        ps->coldList[i].visited = 0;
+		
+		ps->labelCount[i] = 0;
+	}
+
+	for (i=0; i<ps->numArcs; ++i)
+	{
+		ac = &ps->arcList[i];    
+        ac->flow = 0;
+        ac->direction = 1;
+        ac->rescanLabel = 0;
+	}
+    
+     
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+        if (tempArc->to < num_edges) {
+            tempArc->capacity = toCapacity (ps, initial_guess);
+        } else {
+            tempArc->capacity = toCapacity (ps, lambda);
+        }
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->to].excess += tempArc->capacity;
+        printf ("c Reinit: source-adjacent arc (%d, %d): capacity %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity));
+	}
+
+	size = ps->adjacencyList[ps->sink-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];
+		tempArc->flow = tempArc->capacity;
+		ps->adjacencyList[tempArc->from].excess -= tempArc->capacity;
+        printf ("c Reinit: sink-adjacent arc (%d, %d): capacity %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity));
+	}
+
+	ps->adjacencyList[ps->source-1].excess = 0;
+	ps->adjacencyList[ps->sink-1].excess = 0;
+
+	for (i=0; i<ps->numNodes; ++i) 
+	{
+		if (ps->adjacencyList[i].excess > 0)
+		{
+		    ps->adjacencyList[i].label = 1;
+			++ ps->labelCount[1];
+
+			addToStrongBucket (ps, &ps->adjacencyList[i]);
+		}
+	}
+
+	ps->adjacencyList[ps->source-1].label = ps->numNodes;
+	ps->adjacencyList[ps->sink-1].label = 0;
+	ps->labelCount[0] = (ps->numNodes - 2) - ps->labelCount[1];
+
+	countCut (ps);
+}
+
+static inline int 
+addRelationship (Node *newParent, Node *child) 
+{
+	child->parent = newParent;
+	child->prev = NULL;
+	child->next = newParent->childList;
+	if (child->next)
+	{
+		child->next->prev = child;
+	}
+	newParent->childList = child;
+
+	return 0;
+}
+
+static inline void
+breakRelationship (ps_solver *ps, Node *oldParent, Node *child) 
+{
+#ifdef STATS
+	++ ps->numDetaches;
+	if (child->prev)
+	{
+		++ ps->numWalksSaved;
+	}
+#endif
+
+	child->parent = NULL;
+
+	if (child->prev)
+	{
+		child->prev->next = child->next;
+	}
+	else
+	{
+		oldParent->childList = child->next;
+	}
+
+	if (child->next)
+	{
+		child->next->prev = child->prev;
+	}
+
+	child->next = NULL;
+	child->prev = NULL;
+}
+
+static void
+merge (ps_solver *ps, Node *parent, Node *child, Arc *newArc) 
+{
+	Arc *oldArc;
+	Node *current = child, *oldParent, *newParent = parent;
+
+#ifdef STATS
+	++ ps->numMergers;
+#endif
+
+	while (current->parent) 
+	{
+		oldArc = current->arcToParent;
+		current->arcToParent = newArc;
+		oldParent = current->parent;
+		breakRelationship (ps, oldParent, current);
+		addRelationship (newParent, current);
+		newParent = current;
+		current = oldParent;
+		newArc = oldArc;
+		newArc->direction = 1 - newArc->direction;
+	}
+
+	current->arcToParent = newArc;
+	addRelationship (newParent, current);
+}
+
+
+static inline void 
+pushUpward (ps_solver *ps, Arc *currentArc, Node *child, Node *parent, const Capacity resCap) 
+{
+#ifdef STATS
+	++ ps->numPushes;
+#endif
+
+	if (resCap >= child->excess) 
+	{
+		parent->excess += child->excess;
+		currentArc->flow += child->excess;
+		child->excess = 0;
+		return;
+	}
+
+	currentArc->direction = 0;
+	parent->excess += resCap;
+	child->excess -= resCap;
+	currentArc->flow = currentArc->capacity;
+	currentArc->rescanLabel = 0;
+	parent->outOfTree[parent->numOutOfTree] = currentArc - ps->arcList;
+	++ parent->numOutOfTree;
+	breakRelationship (ps, parent, child);
+
+	addToStrongBucket (ps, child);
+}
+
+
+static inline void
+pushDownward (ps_solver *ps, Arc *currentArc, Node *child, Node *parent, Capacity flow) 
+{
+#ifdef STATS
+	++ ps->numPushes;
+#endif
+
+	if (flow >= child->excess) 
+	{
+		parent->excess += child->excess;
+		currentArc->flow -= child->excess;
+		child->excess = 0;
+		return;
+	}
+
+	currentArc->direction = 1;
+	child->excess -= flow;
+	parent->excess += flow;
+	currentArc->flow = 0;
+	currentArc->rescanLabel = 0;
+	parent->outOfTree[parent->numOutOfTree] = currentArc - ps->arcList;
+	++ parent->numOutOfTree;
+	breakRelationship (ps, parent, child);
+
+	addToStrongBucket (ps, child);
+}
+
+static void
+pushExcess (ps_solver *ps, Node *strongRoot) 
+{
+	Node *current, *parent;
+	Arc *arcToParent;
+
+	for (current = strongRoot; (current->excess && current->parent); current = parent) 
+	{
+		parent = current->parent;
+		arcToParent = current->arcToParent;
+		if (arcToParent->direction)
+		{
+			pushUpward (ps, arcToParent, current, parent, (arcToParent->capacity - arcToParent->flow)); 
+		}
+		else
+		{
+			pushDownward (ps, arcToParent, current, parent, arcToParent->flow); 
+		}
+	}
+
+	if (current->excess > 0)
+    //if (current->excess > EPSILON) 
+	{
+		if (!current->next)
+		{
+			addToStrongBucket (ps, current);
+		}
+	}
+}
+
+
+/* An arc in an out-of-tree list cannot be admissible before the node holding it
+   reaches the arc's rescanLabel: that is one above the label its other end had when
+   the arc was last rejected, and labels only grow. Arcs below it are skipped without
+   looking at their ends, so a relabel only revisits the arcs whose other end was at
+   the old label. rescanLabel is cleared whenever an arc enters a list. */
+static Arc *
+findWeakNode (ps_solver *ps, Node *strongNode, Node **weakNode) 
+{
+	int i, size, toLabel, fromLabel, otherLabel;
+	Arc *out;
+
+	size = strongNode->numOutOfTree;
+
+	for (i=strongNode->nextArc; i<size; ++i) 
+	{
+		out = &ps->arcList[strongNode->outOfTree[i]];
+		if (out->rescanLabel > ps->highestStrongLabel)
+		{
+			continue;
+		}
+
+#ifdef STATS
+		++ ps->numArcScans;
+#endif
+		++ ps->relabelWork;
+
+		toLabel = ps->adjacencyList[out->to].label;
+		if (toLabel == (ps->highestStrongLabel-1)) 
+		{
+			strongNode->nextArc = i;
+			(*weakNode) = &ps->adjacencyList[out->to];
+			-- strongNode->numOutOfTree;
+			strongNode->outOfTree[i] = strongNode->outOfTree[strongNode->numOutOfTree];
+			return (out);
+		}
+
+		fromLabel = ps->adjacencyList[out->from].label;
+		if (fromLabel == (ps->highestStrongLabel-1)) 
+		{
+			strongNode->nextArc = i;
+			(*weakNode) = &ps->adjacencyList[out->from];
+			-- strongNode->numOutOfTree;
+			strongNode->outOfTree[i] = strongNode->outOfTree[strongNode->numOutOfTree];
+			return (out);
+		}
+
+		// One end is strongNode itself.
+		otherLabel = toLabel + fromLabel - strongNode->label;
+		if (otherLabel > strongNode->label)
+		{
+			out->rescanLabel = otherLabel + 1;
+		}
+	}
+
+	strongNode->nextArc = strongNode->numOutOfTree;
+
+	return NULL;
+}
+
+
+static void
+checkChildren (ps_solver *ps, Node *curNode) 
+{
+	for ( ; (curNode->nextScan); curNode->nextScan = curNode->nextScan->next)
+	{
+		if (curNode->nextScan->label == curNode->label)
+		{
+			return;
+		}
+		
+	}	
+
+	-- ps->labelCount[curNode->label];
+	++	curNode->label;
+	++ ps->labelCount[curNode->label];
+
+#ifdef STATS
+	++ ps->numRelabels;
+#endif
+	++ ps->relabelWork;
+
+	curNode->nextArc = 0;
+}
+
+static void
+processRoot (ps_solver *ps, Node *strongRoot) 
+{
+	Node *temp, *strongNode = strongRoot, *weakNode;
+	Arc *out;
+
+	strongRoot->nextScan = strongRoot->childList;
+
+	if ((out = findWeakNode (ps, strongRoot, &weakNode)))
+	{
+		merge (ps, weakNode, strongNode, out);
+		pushExcess (ps, strongRoot);
+		return;
+	}
+
+	checkChildren (ps, strongRoot);
+	
+	while (strongNode)
+	{
+		while (strongNode->nextScan) 
+		{
+			temp = strongNode->nextScan;
+			strongNode->nextScan = strongNode->nextScan->next;
+			strongNode = temp;
+			strongNode->nextScan = strongNode->childList;
+
+			if ((out = findWeakNode (ps, strongNode, &weakNode)))
+			{
+				merge (ps, weakNode, strongNode, out);
+				pushExcess (ps, strongRoot);
+				return;
+			}
+
+			checkChildren (ps, strongNode);
+		}
+
+		if ((strongNode = strongNode->parent))
+		{
+			checkChildren (ps, strongNode);
+		}
+	}
+
+	addToStrongBucket (ps, strongRoot);
+
+	++ ps->highestStrongLabel;
+}
+
+static Node *
+getHighestStrongRoot (ps_solver *ps) 
+{
+	int i;
+	Node *strongRoot;
+
+	i = (ps->highestStrongLabel < ps->numNodes) ? ps->highestStrongLabel : (ps->numNodes-1);
+
+	// Most of the time the current bucket is still the highest non-empty one.
+	if (ps->strongRoots[i].start->next == ps->strongRoots[i].end)
+	{
+		i = highestBucket (ps, i);
+	}
+
+	for ( ; i>0; i=highestBucket (ps, i-1)) 
+	{
+		ps->highestStrongLabel = i;
+		if (ps->labelCount[i-1]) 
+		{
+			strongRoot = ps->strongRoots[i].start->next;
+			removeStrongRoot (ps, strongRoot, i);
+			strongRoot->next = NULL;
+			return strongRoot;				
+		}
+
+		while (ps->strongRoots[i].start->next != ps->strongRoots[i].end) 
+		{
+
+#ifdef STATS
+			++ ps->numGaps;
+#endif
+			strongRoot = ps->strongRoots[i].start->next;
+			removeStrongRoot (ps, strongRoot, i);
+			liftAll (ps, strongRoot);
+		}
+	}
+
+	if (ps->strongRoots[0].start->next == ps->strongRoots[0].end) 
+	{
+		return NULL;
+	}
+
+	while (ps->strongRoots[0].start->next != ps->strongRoots[0].end) 
+	{
+		strongRoot = ps->strongRoots[0].start->next;
+		removeStrongRoot (ps, strongRoot, 0);
+
+		strongRoot->label = 1;
+		-- ps->labelCount[0];
+		++ ps->labelCount[1];
+
+#ifdef STATS
+		++ ps->numRelabels;
+#endif
+
+		addToStrongBucket (ps, strongRoot);
+	}	
+
+	ps->highestStrongLabel = 1;
+
+	strongRoot = ps->strongRoots[1].start->next;
+	removeStrongRoot (ps, strongRoot, 1);
+	strongRoot->next = NULL;
+
+	return strongRoot;	
+}
+
+static Capacity getNewCapacity (ps_solver *ps, const Capacity capParameter, const Arc *tempArc)
+{
+    Capacity newcapacity = -1;
+    if (tempArc->from == (ps->source-1))
+    {
+        newcapacity = capParameter;
+    }
+    else
+    {
+        if (tempArc->to == (ps->sink-1))
+        {
+            newcapacity = tempArc->capacity;
+        }
+    }
+    
+    return newcapacity;
+}
+
+static void
+updateCapacities (ps_solver *ps, const double capParameter)
+{
+	int i, size;
+	Capacity delta, newcapacity, parameter = toCapacity (ps, capParameter);
+	Arc *tempArc;
+    
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		
+        tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+       
+		newcapacity = getNewCapacity (ps, parameter, tempArc);
+        delta = (newcapacity - tempArc->capacity);
+               
+		if (delta < 0)
+		{
+			printf ("c Error on source-adjacent arc (%d, %d): capacity decreases by %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, -delta));
+			exit(0);
+		}
+
+		tempArc->capacity += delta;
+		if (isCutArc (ps, tempArc))
+		{
+			addToCut (ps, delta);
+		}
+		tempArc->flow += delta;
+		ps->adjacencyList[tempArc->to].excess += delta;
+
+		if ((ps->adjacencyList[tempArc->to].label < ps->numNodes) && (ps->adjacencyList[tempArc->to].excess > 0))
+		{
+			pushExcess (ps, &ps->adjacencyList[tempArc->to]);
+		}
+	}
+
+	size = ps->adjacencyList[ps->sink-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];
+        newcapacity = getNewCapacity (ps, parameter, tempArc);
+        delta = (newcapacity - tempArc->capacity);       
+       
+		if (delta > 0)
+		{
+			printf ("c Error on sink-adjacent arc (%d, %d): capacity %.3f increases to %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity),
+				fromCapacity (ps, newcapacity));
+			exit(0);
+		}
+
+		tempArc->capacity += delta;
+		if (isCutArc (ps, tempArc))
+		{
+			addToCut (ps, delta);
+		}
+		tempArc->flow += delta;
+		ps->adjacencyList[tempArc->from].excess -= delta;
+
+		if ((ps->adjacencyList[tempArc->from].label < ps->numNodes) && (ps->adjacencyList[tempArc->from].excess > 0))
+		{
+			pushExcess (ps, &ps->adjacencyList[tempArc->from]);
+		}
+	}
+
+	ps->highestStrongLabel = (ps->numNodes-1);
+}
+
+
+static void
+updateSrcCapacities (ps_solver *ps, const double capParameter, const int num_edges)
+{
+	int i, size;
+	Capacity delta, newcapacity = toCapacity (ps, capParameter);
+	Arc *tempArc;
+    
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+        if (tempArc->to < num_edges)
+        {
+            
+            delta = (newcapacity - tempArc->capacity);
+                   
+            if (delta < -CAPACITY_EPSILON)
+            {
+                printf ("c Error on source-adjacent arc (%d, %d): capacity decreases by %.13f.\n",
+                    ps->oldIndex[tempArc->from] + 1,
+                    ps->oldIndex[tempArc->to] + 1,
+                    fromCapacity (ps, -delta));
+                exit(0);
+            }
+
+            tempArc->capacity += delta;
+            if (isCutArc (ps, tempArc))
+            {
+                addToCut (ps, delta);
+            }
+            tempArc->flow += delta;
+            ps->adjacencyList[tempArc->to].excess += delta;
+
+            if ((ps->adjacencyList[tempArc->to].label < ps->numNodes) && (ps->adjacencyList[tempArc->to].excess > 0))
+            {
+                pushExcess (ps, &ps->adjacencyList[tempArc->to]);
+            }
+        }
+	}
+
+	
+
+	ps->highestStrongLabel = (ps->numNodes-1);
+}
+
+static void
+updateNodeCapacities (ps_solver *ps, const double lambda)
+{
+	int i, size;
+	Capacity delta, newcapacity = toCapacity (ps, lambda);
+	Arc *tempArc;
+    
+	size = ps->adjacencyList[ps->source-1].numOutOfTree;
+	for (i=0; i<size; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+        if (tempArc->to >= ps->numEdges)
+        {
+            delta = (newcapacity - tempArc->capacity);
+
+            tempArc->capacity += delta;
+            if (isCutArc (ps, tempArc))
+            {
+                addToCut (ps, delta);
+            }
+            tempArc->flow += delta;
+            ps->adjacencyList[tempArc->to].excess += delta;
+
+            if ((ps->adjacencyList[tempArc->to].label < ps->numNodes) && (ps->adjacencyList[tempArc->to].excess > 0))
+            {
+                pushExcess (ps, &ps->adjacencyList[tempArc->to]);
+            }
+        }
+	}
+
+	ps->highestStrongLabel = (ps->numNodes-1);
+}
+
+static void
+updateSinkCapacities (ps_solver *ps, const double sinkDelta)
+{
+	int i, size;	
+	Capacity delta = toCapacity (ps, sinkDelta);
+	Arc *tempArc;
+
+	size = ps->adjacencyList[ps->sink-1].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];       
+		if (delta > 0)
+		{
+			printf ("c Error on sink-adjacent arc (%d, %d): capacity %.3f increases to %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity),
+				fromCapacity (ps, tempArc->capacity + delta));
+			exit(0);
+		}
+        printf ("c sink-adjacent arc (%d, %d): capacity %.3f increases   to %.3f.\n",
+				ps->oldIndex[tempArc->from] + 1,
+				ps->oldIndex[tempArc->to] + 1,
+				fromCapacity (ps, tempArc->capacity),
+				fromCapacity (ps, tempArc->capacity + delta));
+		tempArc->capacity += delta;
+		if (isCutArc (ps, tempArc))
+		{
+			addToCut (ps, delta);
+		}
+		tempArc->flow += delta;
+		ps->adjacencyList[tempArc->from].excess -= delta;
+
+		if ((ps->adjacencyList[tempArc->from].label < ps->numNodes) && (ps->adjacencyList[tempArc->from].excess > 0))
+		{
+			pushExcess (ps, &ps->adjacencyList[tempArc->from]);
+		}
+	}
+
+	ps->highestStrongLabel = (ps->numNodes-1);
+}
+
+
+
+
+
+/* Queues at label the strong nodes still unsettled that v bounds from above: the tails
+   of its residual arcs and its children. */
+static inline void
+relabelPredecessors (ps_solver *ps, const int v, const int label)
+{
+	int u, *distance = ps->relabelSpace, n = ps->numNodes;
+	int *next = &distance[n], *pred = &next[2*n];
+	ArcIndex j, *first = ps->relabelFirst, *head = &first[n+1];
+	Node *child;
+
+	for (j=first[v]; j<first[v+1]; ++j)
+	{
+		u = pred[j];
+		if (distance[u] == n+1)
+		{
+			distance[u] = n+2;
+			next[u] = head[label];
+			head[label] = u;
+		}
+	}
+
+	for (child = ps->adjacencyList[v].childList; (child); child = child->next)
+	{
+		u = child - ps->adjacencyList;
+		if (distance[u] == n+1)
+		{
+			distance[u] = n+2;
+			next[u] = head[label];
+			head[label] = u;
+		}
+	}
+}
+
+/* Raises the labels of the strong nodes to the largest ones that stay valid: a node
+   is at most one above the other end of each of its residual arcs, a parent is at
+   most at the label of its children and a child at most one above its parent. Weak
+   nodes, and strong nodes with no chain of such bounds to one, keep their labels and
+   seed a bucketed search backwards over the bounds; lifting is left to the gaps this
+   opens. */
+static void
+globalRelabel (ps_solver *ps)
+{
+	llint i;
+	ArcIndex j, *first, *head;
+	int u, v, b, qn, pass, label, n = ps->numNodes;
+	int *distance, *next, *queue, *pred;
+	Node *nd, *parent;
+	Arc *ac;
+
+	if (ps->relabelSpace == NULL)
+	{
+		if (((ps->relabelSpace = (int *) malloc ((3*n + 2*ps->numArcs) * sizeof (int))) == NULL) ||
+			((ps->relabelFirst = (ArcIndex *) malloc ((2*n + 1) * sizeof (ArcIndex))) == NULL))
+		{
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
+		}
+	}
+
+	distance = ps->relabelSpace;
+	next = &distance[n];
+	queue = &next[n];
+	pred = &queue[n];
+	first = ps->relabelFirst;
+	head = &first[n+1];
+
+#ifdef STATS
+	++ ps->numGlobalRelabels;
+#endif
+	ps->relabelWork = 0;
+
+	// Strong nodes start at n, everything else at -1.
+	for (i=0; i<n; ++i)
+	{
+		distance[i] = -1;
+	}
+
+	for (i=0; i<n; ++i)
+	{
+		nd = &ps->adjacencyList[i];
+		if (nd->parent || (nd->label >= n) || (nd->excess <= 0))
+		{
+			continue;
+		}
+
+		qn = 0;
+		queue[qn++] = i;
+		while (qn)
+		{
+			v = queue[--qn];
+			distance[v] = n;
+			for (nd = ps->adjacencyList[v].childList; (nd); nd = nd->next)
+			{
+				queue[qn++] = nd - ps->adjacencyList;
+			}
+		}
+	}
+
+	// Residual arcs between unlifted inner nodes out of strong nodes, listed at their
+	// heads; the first pass counts them, the second fills them in.
+	for (i=0; i<=n; ++i)
+	{
+		first[i] = 0;
+	}
+
+	for (pass=0; pass<2; ++pass)
+	{
+		for (i=0; i<ps->numArcs; ++i)
+		{
+			ac = &ps->arcList[i];
+			u = ac->from;
+			v = ac->to;
+			if ((u == v) || (ps->adjacencyList[u].label >= n) || (ps->adjacencyList[v].label >= n) ||
+				(u == (ps->sink-1)) || (v == (ps->sink-1)))
+			{
+				continue;
+			}
+
+			if ((distance[u] == n) && (ac->flow < ac->capacity))
+			{
+				if (pass)
+				{
+					pred[head[v]++] = u;
+				}
+				else
+				{
+					++ first[v+1];
+				}
+			}
+
+			if ((distance[v] == n) && (ac->flow > 0))
+			{
+				if (pass)
+				{
+					pred[head[u]++] = v;
+				}
+				else
+				{
+					++ first[u+1];
+				}
+			}
+		}
+
+		if (!pass)
+		{
+			for (i=0; i<n; ++i)
+			{
+				first[i+1] += first[i];
+				head[i] = first[i];
+			}
+		}
+	}
+
+	// Strong nodes bounded by a weak node move from n to n+1.
+	qn = 0;
+	for (v=0; v<n; ++v)
+	{
+		if ((distance[v] == -1) && (ps->adjacencyList[v].label < n))
+		{
+			queue[qn++] = v;
+		}
+	}
+
+	for (i=0; i<qn; ++i)
+	{
+		v = queue[i];
+		for (j=first[v]; j<first[v+1]; ++j)
+		{
+			if (distance[pred[j]] == n)
+			{
+				distance[pred[j]] = n+1;
+				queue[qn++] = pred[j];
+			}
+		}
+
+		if (distance[v] == -1)
+		{
+			continue;
+		}
+
+		for (nd = ps->adjacencyList[v].childList; (nd); nd = nd->next)
+		{
+			if (distance[nd - ps->adjacencyList] == n)
+			{
+				distance[nd - ps->adjacencyList] = n+1;
+				queue[qn++] = nd - ps->adjacencyList;
+			}
+		}
+
+		parent = ps->adjacencyList[v].parent;
+		if (parent && (distance[parent - ps->adjacencyList] == n))
+		{
+			distance[parent - ps->adjacencyList] = n+1;
+			queue[qn++] = parent - ps->adjacencyList;
+		}
+	}
+
+	// Those get their labels in increasing order; n+2 marks them as queued.
+	for (i=0; i<n; ++i)
+	{
+		head[i] = -1;
+	}
+
+	for (v=0; v<n; ++v)
+	{
+		label = ps->adjacencyList[v].label;
+		if (((distance[v] == -1) && (label < n)) || (distance[v] == n))
+		{
+			next[v] = head[label];
+			head[label] = v;
+		}
+	}
+
+	for (b=0; b<n; ++b)
+	{
+		while ((v = head[b]) != -1)
+		{
+			head[b] = next[v];
+			if ((distance[v] >= 0) && (distance[v] < n))
+			{
+				continue;
+			}
+
+			if (distance[v] == n+2)
+			{
+				distance[v] = b;
+			}
+
+			// A parent is settled together with its child.
+			for (u=v; ; u=parent - ps->adjacencyList)
+			{
+				relabelPredecessors (ps, u, ((b+1 < n) ? (b+1) : b));
+
+				parent = ps->adjacencyList[u].parent;
+				if ((distance[u] == -1) || !parent || (distance[parent - ps->adjacencyList] <= n))
+				{
+					break;
+				}
+				distance[parent - ps->adjacencyList] = b;
+			}
+		}
+	}
+
+	for (i=0; i<n; ++i)
+	{
+		nd = &ps->adjacencyList[i];
+		if ((distance[i] < 0) || (distance[i] >= n) || (distance[i] <= nd->label))
+		{
+			continue;
+		}
+
+		-- ps->labelCount[nd->label];
+		++ ps->labelCount[distance[i]];
+		if (nd->parent)
+		{
+			nd->label = distance[i];
+		}
+		else
+		{
+			removeStrongRoot (ps, nd, nd->label);
+			nd->label = distance[i];
+			addToStrongBucket (ps, nd);
+		}
+		nd->nextArc = 0;
+	}
+
+	ps->highestStrongLabel = n-1;
+}
+
+static void
+pseudoflowPhase1 (ps_solver *ps) 
+{
+	Node *strongRoot;
+	double thetime;
+    
+	thetime = timer ();
+	ps->relabelWork = 0;
+    
+	while ((strongRoot = getHighestStrongRoot (ps)))  
+	{ 
+		processRoot (ps, strongRoot);
+
+		if ((ps->relabelFrequency > 0) && (ps->relabelWork * ps->relabelFrequency > (ps->numNodes + ps->numArcs)))
+		{
+			globalRelabel (ps);
+		}
+	}
+}
+
+static void
+checkOptimality (ps_solver *ps) 
+{
+	llint i;
+	int check = 1;
+	Capacity mincut = 0, *excess;
+    Capacity difference;
+
+	excess = (Capacity *) malloc (ps->numNodes * sizeof (Capacity));
+	if (!excess)
+	{
+		printf ("%s Line %d: Out of memory\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	for (i=0; i<ps->numNodes; ++i)
+	{
+		excess[i] = 0;
+	}
+
+	for (i=0; i<ps->numArcs; ++i) 
+	{
+		if ((ps->adjacencyList[ps->arcList[i].from].label >= ps->numNodes) && (ps->adjacencyList[ps->arcList[i].to].label < ps->numNodes))
+		{
+			mincut += ps->arcList[i].capacity;
+		}
+
+		if ((ps->arcList[i].flow > ps->arcList[i].capacity) || (ps->arcList[i].flow < 0)) 
+		{
+			check = 0;
+			printf("c Capacity constraint violated on arc (%d, %d)\n", 
+				ps->oldIndex[ps->arcList[i].from] + 1,
+				ps->oldIndex[ps->arcList[i].to] + 1);
+		}
+		excess[ps->arcList[i].from] -= ps->arcList[i].flow;
+		excess[ps->arcList[i].to] += ps->arcList[i].flow;
+	}
+    
+    printf("c Mincut: %.3f\n", fromCapacity (ps, mincut));
+
+	for (i=0; i<ps->numNodes; i++) 
+	{
+		if ((i != (ps->source-1)) && (i != (ps->sink-1))) 
+		{
+			if ((excess[i] > CAPACITY_EPSILON) || (excess[i] < -CAPACITY_EPSILON)) 
+			{
+				check = 0;
+				printf ("c Flow balance constraint violated in node %d. Excess = %.15f\n", 
+					ps->oldIndex[i]+1,
+					fromCapacity (ps, excess[i]));
+			}
+		}
+	}
+
+	if (check)
+	{
+		printf ("c\nc Solution checks as feasible.\n");
+	}
+
+	check = 1;
+    difference = excess[ps->sink-1] - mincut;
+	if ((difference > CAPACITY_EPSILON) || (difference < -CAPACITY_EPSILON)) 
+	{
+		check = 0;
+		printf("c Flow is not optimal - max flow does not equal min cut! Difference: %.6f, %.6f\nc\n",
+			fromCapacity (ps, excess[ps->sink-1]), fromCapacity (ps, mincut));
+	}
+
+	if (check) 
+	{
+		printf ("c\nc Solution checks as optimal.\nc \n");
+		printf ("s Max Flow            : %.3f\n", fromCapacity (ps, mincut));
+	}
+
+	free (excess);
+	excess = NULL;
+}
+
+
+static void
+quickSort (const Arc *arcs, ArcIndex *arr, const int first, const int last)
+{
+	int i, j, left=first, right=last, mid, pivot;
+    Capacity x1, x2, x3, pivotval;
+	ArcIndex swap;
+
+	if ((right-left) <= 5)
+	{// Bubble sort if 5 elements or less
+		for (i=right; (i>left); --i)
+		{
+			swap = -1;
+			for (j=left; j<i; ++j)
+			{
+				if (arcs[arr[j]].flow < arcs[arr[j+1]].flow)
+				{
+					swap = arr[j];
+					arr[j] = arr[j+1];
+					arr[j+1] = swap;
+				}
+			}
+
+			if (swap < 0)
+			{
+				return;
+			}
+		}
+
+		return;
+	}
+
+	mid = (first+last)/2;
+
+	x1 = arcs[arr[first]].flow; 
+	x2 = arcs[arr[mid]].flow; 
+	x3 = arcs[arr[last]].flow;
+
+	pivot = mid;
+	
+	if (x1 <= x2)
+	{
+		if (x2 > x3)
+		{
+			pivot = left;
+
+			if (x1 <= x3)
+			{
+				pivot = right;
+			}
+		}
+	}
+	else
+	{
+		if (x2 <= x3)
+		{
+			pivot = right;
+
+			if (x1 <= x3)
+			{
+				pivot = left;
+			}
+		}
+	}
+
+	pivotval = arcs[arr[pivot]].flow;
+
+	swap = arr[first];
+	arr[first] = arr[pivot];
+	arr[pivot] = swap;
+
+	left = (first+1);
+
+	while (left < right)
+	{
+		if (arcs[arr[left]].flow < pivotval)
+		{
+			swap = arr[left];
+			arr[left] = arr[right];
+			arr[right] = swap;
+			-- right;
+		}
+		else
+		{
+			++ left;
+		}
+	}
+
+	swap = arr[first];
+	arr[first] = arr[left];
+	arr[left] = swap;
+
+	if (first < (left-1))
+	{
+		quickSort (arcs, arr, first, (left-1));
+	}
+	
+	if ((left+1) < last)
+	{
+		quickSort (arcs, arr, (left+1), last);
+	}
+}
+
+static void
+sort (ps_solver *ps, Node * current)
+{
+	if (current->numOutOfTree > 1)
+	{
+		quickSort (ps->arcList, current->outOfTree, 0, (current->numOutOfTree-1));
+	}
+}
+
+static void
+minisort (ps_solver *ps, Node *current) 
+{
+	ArcIndex temp = current->outOfTree[current->nextArc];
+	int i, size = current->numOutOfTree;
+    Capacity tempflow = ps->arcList[temp].flow;
+
+	for(i=current->nextArc+1; ((i<size) && (tempflow < ps->arcList[current->outOfTree[i]].flow)); ++i)
+	{
+		current->outOfTree[i-1] = current->outOfTree[i];
+	}
+	current->outOfTree[i-1] = temp;
+}
+
+static void
+decompose (ps_solver *ps, Node *excessNode, const int source, int *iteration) 
+{
+	Node *current = excessNode;
+	Arc *tempArc;
+	Capacity bottleneck = excessNode->excess;
+
+	for ( ;(current->number != source) && (ps->coldList[current - ps->adjacencyList].visited < (*iteration)); 
+				current = &ps->adjacencyList[tempArc->from])
+	{
+		ps->coldList[current - ps->adjacencyList].visited = (*iteration);
+		tempArc = &ps->arcList[current->outOfTree[current->nextArc]];
+
+		if (tempArc->flow < bottleneck)
+		{
+			bottleneck = tempArc->flow;
+		}
+	}
+
+	if (current->number == source) 
+	{
+		excessNode->excess -= bottleneck;
+		current = excessNode;
+
+		while (current->number != source) 
+		{
+			tempArc = &ps->arcList[current->outOfTree[current->nextArc]];
+			tempArc->flow -= bottleneck;
+
+			if (tempArc->flow) 
+			{
+				minisort(ps, current);
+			}
+			else 
+			{
+				++ current->nextArc;
+			}
+			current = &ps->adjacencyList[tempArc->from];
+		}
+		return;
+	}
+
+	++ (*iteration);
+
+	bottleneck = ps->arcList[current->outOfTree[current->nextArc]].flow;
+
+	while (ps->coldList[current - ps->adjacencyList].visited < (*iteration))
+	{
+		ps->coldList[current - ps->adjacencyList].visited = (*iteration);
+		tempArc = &ps->arcList[current->outOfTree[current->nextArc]];
+
+		if (tempArc->flow < bottleneck)
+		{
+			bottleneck = tempArc->flow;
+		}
+		current = &ps->adjacencyList[tempArc->from];
+	}	
+	
+	++ (*iteration);
+
+	while (ps->coldList[current - ps->adjacencyList].visited < (*iteration))
+	{
+		ps->coldList[current - ps->adjacencyList].visited = (*iteration);
+
+		tempArc = &ps->arcList[current->outOfTree[current->nextArc]];
+		tempArc->flow -= bottleneck;
+
+		if (tempArc->flow) 
+		{
+			minisort(ps, current);
+			current = &ps->adjacencyList[tempArc->from];
+		}
+		else 
+		{
+			++ current->nextArc;
+			current = &ps->adjacencyList[tempArc->from];
+		}
+	}
+}
+
+static void
+recoverFlow (ps_solver *ps)
+{
+	int i, j, iteration = 1;
+	Arc *tempArc;
+	Node *tempNode;
+
+	for (i=0; i<ps->adjacencyList[ps->sink-1].numOutOfTree; ++i) 
+	{
+		
+        tempArc = &ps->arcList[ps->adjacencyList[ps->sink-1].outOfTree[i]];
+                
+		if (ps->adjacencyList[tempArc->from].excess < 0) 
+		{
+			tempArc->flow -= (-1*ps->adjacencyList[tempArc->from].excess);            
+			ps->adjacencyList[tempArc->from].excess = 0;
+		}        
+	}
+    
+	for (i=0; i<ps->adjacencyList[ps->source-1].numOutOfTree; ++i) 
+	{
+		tempArc = &ps->arcList[ps->adjacencyList[ps->source-1].outOfTree[i]];
+		addOutOfTreeNode (ps, &ps->adjacencyList[tempArc->to], tempArc);
+	}
+    ps->adjacencyList[ps->source-1].excess = 0;
+	ps->adjacencyList[ps->sink-1].excess = 0;
+    
+	for (i=0; i<ps->numNodes; ++i) 
+	{
+		tempNode = &ps->adjacencyList[i];
+
+		if ((i == (ps->source-1)) || (i == (ps->sink-1)))
+		{
+			continue;
+		}
+
+		if (tempNode->label >= ps->numNodes) 
+		{
+			tempNode->nextArc = 0;            
+			if ((tempNode->parent) && (tempNode->arcToParent->flow))
+            //if ((tempNode->parent) && ((tempNode->arcToParent->flow > EPSILON) || (tempNode->arcToParent->flow < -EPSILON)))
+			{
+				//printf ("c tempNode->arcToParent->flow: %.10f\n",  tempNode->arcToParent->flow);
+                addOutOfTreeNode (ps, &ps->adjacencyList[tempNode->arcToParent->to], tempNode->arcToParent);
+			}
+            //printf ("aaaa");
+			for (j=0; j<tempNode->numOutOfTree; ++j) 
+			{
+				if (!ps->arcList[tempNode->outOfTree[j]].flow) 
+                //if ((tempNode->arcToParent->flow < EPSILON) && (tempNode->arcToParent->flow > -EPSILON)) 
+				{
+					-- tempNode->numOutOfTree;
+					tempNode->outOfTree[j] = tempNode->outOfTree[tempNode->numOutOfTree];
+					-- j;
+				}
+			}
+
+			sort(ps, tempNode);
+		}
+	}
+    for (i=0; i<ps->numNodes; ++i) 
+	{
+		tempNode = &ps->adjacencyList[i];
+		while (tempNode->excess > CAPACITY_EPSILON) 
+		{
+            ++ iteration;
+			decompose(ps, tempNode, ps->source, &iteration);
+		}
+	}    
+}
+
+
+
+static void
+freeMemory (ps_solver *ps)
+{
+	free (ps->strongRoots);
+	ps->strongRoots = NULL;
+
+	free (ps->rootSentinels);
+	ps->rootSentinels = NULL;
+
+	free (ps->bucketBits);
+	ps->bucketBits = NULL;
+
+	free (ps->adjacencyList);
+	ps->adjacencyList = NULL;
+
+	free (ps->outOfTreeSpace);
+	ps->outOfTreeSpace = NULL;
+
+	free (ps->newIndex);
+	ps->newIndex = NULL;
+
+	free (ps->oldIndex);
+	ps->oldIndex = NULL;
+
+	free (ps->coldList);
+	ps->coldList = NULL;
+
+	free (ps->labelCount);
+	ps->labelCount = NULL;
+
+	free (ps->arcList);
+	ps->arcList = NULL;
+
+	free (ps->firstIncident);
+	ps->firstIncident = NULL;
+
+	free (ps->incident);
+	ps->incident = NULL;
+
+	free (ps->firstTerminal);
+	ps->firstTerminal = NULL;
+
+	free (ps->terminal);
+	ps->terminal = NULL;
+
+	free (ps->relabelSpace);
+	ps->relabelSpace = NULL;
+
+	free (ps->relabelFirst);
+	ps->relabelFirst = NULL;
+}
+
+static void
+freeFrontier (ps_solver *ps)
+{
+	int i;
+
+	for (i=0; i<ps->numSolutions; ++i)
+	{
+		free (ps->frontier[i].edges);
+	}
+
+	free (ps->frontier);
+	ps->frontier = NULL;
+	ps->numSolutions = 0;
+}
+
+extern ps_solver *ps_create(void)
+{
+	ps_solver *ps;
+
+	if ((ps = (ps_solver *) calloc (1, sizeof (ps_solver))) == NULL)
+	{
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
+	}
+
+	ps->highestStrongLabel = 1;
+	ps->capacityScale = CAPACITY_SCALE;
+
+	return ps;
+}
+
+extern void c_readDimacsFileCreateList(ps_solver *ps, const char *filename)
+{
+    readDimacsFileCreateList (ps, filename);
+}
+extern void c_readBinaryFileCreateList(ps_solver *ps, const char *filename)
+{
+    readBinaryFileCreateList (ps, filename);
+}
+extern void c_simpleInitialization(ps_solver *ps){simpleInitialization (ps);}
+extern void c_reInitialization(ps_solver *ps, const double lambda, const double initial_guess, const int num_edges){reInitialization (ps, lambda, initial_guess, num_edges);}
+extern void c_pseudoflowPhase1(ps_solver *ps){pseudoflowPhase1 (ps);}
+extern void c_recoverFlow(ps_solver *ps){recoverFlow (ps);}
+extern void c_checkOptimality(ps_solver *ps){checkOptimality (ps);}
+extern void c_setGlobalRelabel(ps_solver *ps, const double frequency){ps->relabelFrequency = frequency;}
+
+/* Units per 1 of the FIXED_POINT capacities; capacities are converted when the graph is
+   read, so this has to come first. The double build ignores it. */
+extern void c_setCapacityScale(ps_solver *ps, const double scale)
+{
+	if ((scale <= 0) || (ps->adjacencyList))
+	{
+		printf ("c Error: the capacity scale must be positive and set before the graph is read.\n");
+		exit (1);
+	}
+
+	ps->capacityScale = scale;
+}
+
+/* Lays the nodes out in breadth-first order before solving (see createRenumbering);
+   every index the library takes or returns stays in the numbering of the file. */
+extern void c_setRenumbering(ps_solver *ps, const int renumber)
+{
+	if (ps->adjacencyList)
+	{
+		printf ("c Error: renumbering must be chosen before the graph is read.\n");
+		exit (1);
+	}
+
+	ps->renumber = renumber;
+}
+extern int c_getNumNodes(ps_solver *ps){return ps->numNodes;}
+extern double c_getMinCutValue(ps_solver *ps){return (ps->numInfiniteCut ? INFINITY : fromCapacity (ps, ps->cutValue) + ps->cutError);}
+
+extern void c_getMinCutEdgeSet(ps_solver *ps, const int num_edges, int *sourceSet)
+{
+    
+    int i = 0;
+    
+    // The edge-vertices are numbered first, so only they need to be visited.
+    for (i = 0; (i < num_edges) && (i < ps->numNodes); ++i)
+    {
+        if (ps->adjacencyList[ps->newIndex[i]].label < ps->numNodes)
+        {
+            sourceSet[i] = 1;
+        }
+        else
+        {
+            sourceSet[i] = 0;
+        }
+    }   
+}
+
+extern void c_getSizeOfMinCutSet(ps_solver *ps, const int num_edges, int *F_edges, int *F_nodes)
+{
+    
+    int i;    
+
+    if (num_edges == ps->numEdges)
+    {
+        *F_edges = ps->cutEdges;
+        *F_nodes = ps->cutNodes;
+        return;
+    }
+
+    *F_edges = 0;
+    *F_nodes = 0;
+    for (i = 0; i < ps->numNodes; ++i)
+    {
+        
+        if ((ps->adjacencyList[i].label < ps->numNodes) && !isAuxiliary (ps, ps->adjacencyList[i].number))
+        {
+            if (ps->adjacencyList[i].number <= num_edges)
+            {
+                
+                (*F_edges)++;
+            }
+            else
+            {
+                
+                (*F_nodes)++;
+            }           
+        }
+    }
+    (*F_nodes)--;
+    
+}
 
-	strongNode->nextArc = strongNode->numOutOfTree;
+extern void c_updateCapacities(ps_solver *ps, const double capParameter){updateCapacities (ps, capParameter);}
+extern void c_updateSinkCapacities(ps_solver *ps, const double delta){updateSinkCapacities (ps, delta);}
+extern void c_updateSrcCapacities(ps_solver *ps, const double newcapacity, const int num_edges) { updateSrcCapacities (ps, newcapacity, num_edges);}
 
-	return NULL;
+extern void c_reCreateGraph(ps_solver *ps, const int num_edges, const double lambda, const double c)
+{ 
+    ps->highestStrongLabel = 1;
+    reCreateGraph (ps, num_edges, lambda, c); 
+    simpleInitialization (ps);
 }
 
-
-static void
-checkChildren (Node *curNode) 
+extern void c_finalfreeMemory(ps_solver *ps)
 {
-	for ( ; (curNode->nextScan); curNode->nextScan = curNode->nextScan->next)
-	{
-		if (curNode->nextScan->label == curNode->label)
-		{
-			return;
-		}
-		
-	}	
-
-	-- labelCount[curNode->label];
-	++	curNode->label;
-	++ labelCount[curNode->label];
+    freeMemory (ps);
+    freeFrontier (ps);
+    free(ps->cutSet);
+    free(ps->prevCutSet);
+    free(ps->querySet);
+    ps->cutSet = NULL;
+    ps->prevCutSet = NULL;
+    ps->querySet = NULL;
+    ps->querySetSize = 0;
+    ps->warmStart = 0;
+    releaseTopology(ps->graph);
+    ps->graph = NULL;
+}
 
+extern void c_freeMemory(ps_solver *ps){freeMemory (ps);}
+extern void c_print_pars(ps_solver *ps)
+{
+	printf ("c Number of nodes     : %d\n", ps->numNodes);
+	printf ("c Number of arcs      : %lld\n", ps->numArcs);
 #ifdef STATS
-	++ numRelabels;
+	printf ("c Number of arc scans : %lld\n", ps->numArcScans);
+	printf ("c Number of mergers   : %lld\n", ps->numMergers);
+	printf ("c Number of pushes    : %lld\n", ps->numPushes);
+	printf ("c Number of relabels  : %lld\n", ps->numRelabels);
+	printf ("c Number of gaps      : %lld\n", ps->numGaps);
+	printf ("c Number of detaches  : %lld\n", ps->numDetaches);
+	printf ("c Child walks saved   : %lld\n", ps->numWalksSaved);
+	printf ("c Global relabels     : %lld\n", ps->numGlobalRelabels);
 #endif
-
-	curNode->nextArc = 0;
 }
 
-static void
-processRoot (Node *strongRoot) 
+extern void ps_destroy(ps_solver *ps)
 {
-	Node *temp, *strongNode = strongRoot, *weakNode;
-	Arc *out;
-
-	strongRoot->nextScan = strongRoot->childList;
-
-	if ((out = findWeakNode (strongRoot, &weakNode)))
+	if (ps)
 	{
-		merge (weakNode, strongNode, out);
-		pushExcess (strongRoot);
-		return;
+		c_finalfreeMemory (ps);
+		free (ps);
 	}
+}
 
-	checkChildren (strongRoot);
-	
-	while (strongNode)
+//---------------  Ratio solver ------------------
+/* Writes the sorted indices of the edge-vertices with label < numNodes to set, in the
+   numbering of the file. Within one solve nodes only leave that set, so the list of an
+   earlier iteration can be filtered instead of scanning all edges; pass previous == NULL
+   right after an initialization. */
+static int
+extractCutSet (ps_solver *ps, const int *previous, const int previousSize, int *set)
+{
+	int i, size = 0;
+
+	if (previous == NULL)
 	{
-		while (strongNode->nextScan) 
+		for (i=0; i<ps->numEdges; ++i)
 		{
-			temp = strongNode->nextScan;
-			strongNode->nextScan = strongNode->nextScan->next;
-			strongNode = temp;
-			strongNode->nextScan = strongNode->childList;
-
-			if ((out = findWeakNode (strongNode, &weakNode)))
+			if (ps->adjacencyList[ps->newIndex[i]].label < ps->numNodes)
 			{
-				merge (weakNode, strongNode, out);
-				pushExcess (strongRoot);
-				return;
+				set[size] = i;
+				++ size;
 			}
-
-			checkChildren (strongNode);
 		}
-
-		if ((strongNode = strongNode->parent))
+	}
+	else
+	{
+		for (i=0; i<previousSize; ++i)
 		{
-			checkChildren (strongNode);
+			if (ps->adjacencyList[ps->newIndex[previous[i]]].label < ps->numNodes)
+			{
+				set[size] = previous[i];
+				++ size;
+			}
 		}
 	}
 
-	addToStrongBucket (strongRoot, strongRoots[strongRoot->label].end);
-
-	++ highestStrongLabel;
+	return size;
 }
 
-static Node *
-getHighestStrongRoot () 
+/* Dinkelbach iterations for one lambda, mirroring the former solve_MinCut in main.py:
+   sim/den and prevCutSet describe the cut of the iteration before the last one.
+   The cut sets are sorted lists of edge indices, with their sizes in cutSetSize and
+   prevCutSetSize.
+   c starts from the ratio the previous solution of this solver reaches under the new
+   lambda, which is a lower bound on the optimum, unless that bound is no better than
+   the cold start -lambda*|V|. lambda and c are rounded to values the capacities can
+   take, so that a c that no longer moves is caught on the fixed-point path as well.
+   Returns the number of Q-iterations. */
+static int
+solveRatio (ps_solver *ps, const double requestedLambda, const double total_sim, const double precision,
+	const int max_iters, double *sim, double *den)
 {
-	int i;
-	Node *strongRoot;
+	int counter, F_edges, F_nodes, warm, size, *swap;
+	double c, seed, newc, Q, mincut;
+	double cur_sim, cur_den, lambda;
 
-	for (i=highestStrongLabel; i>0; --i) 
+	if (ps->cutSet == NULL)
 	{
-		if (strongRoots[i].start->next != strongRoots[i].end)  
+		if (((ps->cutSet = (int *) malloc (ps->numEdges * sizeof (int))) == NULL) ||
+			((ps->prevCutSet = (int *) malloc (ps->numEdges * sizeof (int))) == NULL))
 		{
-			highestStrongLabel = i;
-			if (labelCount[i-1]) 
-			{
-				strongRoot = strongRoots[i].start->next;
-				strongRoot->next->prev = strongRoot->prev;
-				strongRoot->prev->next = strongRoot->next;
-				strongRoot->next = NULL;
-				return strongRoot;				
-			}
-
-			while (strongRoots[i].start->next != strongRoots[i].end) 
-			{
-
-#ifdef STATS
-				++ numGaps;
-#endif
-				strongRoot = strongRoots[i].start->next;
-				strongRoot->next->prev = strongRoot->prev;
-				strongRoot->prev->next = strongRoot->next;
-				liftAll (strongRoot);
-			}
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
 		}
 	}
 
-	if (strongRoots[0].start->next == strongRoots[0].end) 
+	lambda = roundCapacity (ps, requestedLambda);
+	c = roundCapacity (ps, -lambda * (ps->numNodes - ps->numEdges - ps->numAuxiliary - 2));
+	warm = 0;
+
+	if (ps->warmStart)
 	{
-		return NULL;
+		seed = ps->lastSimilarity - lambda/ps->lastDensity;
+		seed -= WARM_START_MARGIN * (1 + ((seed < 0) ? -seed : seed));
+		seed = roundCapacity (ps, seed);
+		if (seed > c)
+		{
+			c = seed;
+			warm = 1;
+		}
 	}
 
-	while (strongRoots[0].start->next != strongRoots[0].end) 
+	for (;;)
 	{
-		strongRoot = strongRoots[0].start->next;
-		strongRoot->next->prev = strongRoot->prev;
-		strongRoot->prev->next = strongRoot->next;
+		ps->highestStrongLabel = 1;
+		reCreateGraph (ps, ps->numEdges, lambda, c);
+		simpleInitialization (ps);
 
-		strongRoot->label = 1;
-		-- labelCount[0];
-		++ labelCount[1];
+		ps->prevCutSetSize = 0;
+		cur_sim = -1;
+		cur_den = -1;
 
-#ifdef STATS
-		++ numRelabels;
-#endif
+		for (counter = 0; counter < max_iters; ++ counter)
+		{
+			pseudoflowPhase1 (ps);
+			mincut = c_getMinCutValue (ps);
 
-		addToStrongBucket (strongRoot, strongRoots[strongRoot->label].end);
-	}	
+			c_getSizeOfMinCutSet (ps, ps->numEdges, &F_edges, &F_nodes);
+			ps->cutSetSize = extractCutSet (ps, (counter ? ps->prevCutSet : NULL), ps->prevCutSetSize, ps->cutSet);
 
-	highestStrongLabel = 1;
+			Q = -mincut + .5*total_sim;
 
-	strongRoot = strongRoots[1].start->next;
-	strongRoot->next->prev = strongRoot->prev;
-	strongRoot->prev->next = strongRoot->next;
-	strongRoot->next = NULL;
+			if ((Q < precision) || (F_edges == 0) || (counter == max_iters-1))
+			{
+				break;
+			}
 
-	return strongRoot;	
-}
+			newc = roundCapacity (ps, Q/F_edges + c);
+			cur_sim = c + (Q + lambda*F_nodes)/F_edges;
+			cur_den = (double) F_edges/F_nodes;
 
-static double getNewCapacity(const double capParameter, const Arc *tempArc)
-{
-    double newcapacity = -1;
-    if (tempArc->from->number == source)
-    {
-        newcapacity = capParameter;
-    }
-    else
-    {
-        if (tempArc->to->number == sink)
-        {
-            newcapacity = tempArc->capacity;
-        }
-    }
-    
-    return newcapacity;
-}
+			swap = ps->cutSet;
+			ps->cutSet = ps->prevCutSet;
+			ps->prevCutSet = swap;
+			size = ps->cutSetSize;
+			ps->cutSetSize = ps->prevCutSetSize;
+			ps->prevCutSetSize = size;
 
-static void
-updateCapacities (const double capParameter)
-{
-	int i, size;
-	double delta, newcapacity;
-	Arc *tempArc;
-    
-	size = adjacencyList[source-1].numOutOfTree;
-	for (i=0; i<size; ++i) 
-	{
-		
-        tempArc = adjacencyList[source-1].outOfTree[i];
-       
-		newcapacity = getNewCapacity(capParameter, tempArc);
-        delta = (newcapacity - tempArc->capacity);
-               
-		if (delta < 0)
-		{
-			printf ("c Error on source-adjacent arc (%d, %d): capacity decreases by %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				(-delta));
-			exit(0);
-		}
+			// Q is rounding noise once it no longer moves c: the next iteration would find this cut again.
+			if (newc == c)
+			{
+				++ counter;
+				break;
+			}
 
-		tempArc->capacity += delta;
-		tempArc->flow += delta;
-		tempArc->to->excess += delta;
+			updateSrcCapacities (ps, newc, ps->numEdges);
 
-		if ((tempArc->to->label < numNodes) && (tempArc->to->excess > 0))
-		{
-			pushExcess (tempArc->to);
+			c = newc;
 		}
-	}
 
-	size = adjacencyList[sink-1].numOutOfTree;
-	for (i=0; i<size; ++i)
-	{
-		tempArc = adjacencyList[sink-1].outOfTree[i];
-        newcapacity = getNewCapacity(capParameter, tempArc);
-        delta = (newcapacity - tempArc->capacity);       
-       
-		if (delta > 0)
+		if ((counter > 0) || (!warm))
 		{
-			printf ("c Error on sink-adjacent arc (%d, %d): capacity %.3f increases to %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity,
-				newcapacity);
-			exit(0);
+			break;
 		}
 
-		tempArc->capacity += delta;
-		tempArc->flow += delta;
-		tempArc->from->excess -= delta;
+		// The seed overshot the optimum: retry from the cold start.
+		c = roundCapacity (ps, -lambda * (ps->numNodes - ps->numEdges - ps->numAuxiliary - 2));
+		warm = 0;
+	}
 
-		if ((tempArc->from->label < numNodes) && (tempArc->from->excess > 0))
-		{
-			pushExcess (tempArc->from);
-		}
+	if (counter > 0)
+	{
+		ps->warmStart = 1;
+		ps->lastSimilarity = cur_sim;
+		ps->lastDensity = cur_den;
 	}
 
-	highestStrongLabel = (numNodes-1);
-}
+	(*sim) = cur_sim;
+	(*den) = cur_den;
 
+	return counter;
+}
 
-static void
-updateSrcCapacities (const double newcapacity, const int num_edges)
+extern int c_solveRatio(ps_solver *ps, const double lambda, const double total_sim, const double precision,
+	const int max_iters, int *out_set, double *out_stats)
 {
-	int i, size;
-	double delta;
-	Arc *tempArc;
-    
-	size = adjacencyList[source-1].numOutOfTree;
-	for (i=0; i<size; ++i) 
-	{
-		tempArc = adjacencyList[source-1].outOfTree[i];
-        if (tempArc->to->number <= num_edges)
-        {
-            
-            delta = (newcapacity - tempArc->capacity);
-                   
-            if (delta < -EPSILON)
-            {
-                printf ("c Error on source-adjacent arc (%d, %d): capacity decreases by %.13f.\n",
-                    tempArc->from->number,
-                    tempArc->to->number,
-                    (-delta));
-                exit(0);
-            }
+    int i, size, iterations;
+    double sim, den;
 
-            tempArc->capacity += delta;
-            tempArc->flow += delta;
-            tempArc->to->excess += delta;
+    iterations = solveRatio (ps, lambda, total_sim, precision, max_iters, &sim, &den);
+    size = ps->prevCutSetSize;
 
-            if ((tempArc->to->label < numNodes) && (tempArc->to->excess > 0))
-            {
-                pushExcess(tempArc->to);
-            }
+    if (out_set)
+    {
+        memset (out_set, 0, ps->numEdges * sizeof (int));
+        for (i = 0; i < size; ++i)
+        {
+            out_set[ps->prevCutSet[i]] = 1;
         }
-	}
+    }
 
-	
+    if (out_stats)
+    {
+        out_stats[0] = sim;
+        out_stats[1] = den;
+        out_stats[2] = iterations;
+        out_stats[3] = size;
+    }
 
-	highestStrongLabel = (numNodes-1);
+    return size;
 }
 
-static void
-updateSinkCapacities (const double delta)
+/* The solution of the last c_solveRatio as a sorted list of edge indices (edge-vertex
+   number - 1); edges must have room for numEdges entries. Returns the list length. */
+extern int c_getRatioEdgeList(ps_solver *ps, int *edges)
 {
-	int i, size;	
-	Arc *tempArc;
+	int size = ps->prevCutSetSize;
 
-	size = adjacencyList[sink-1].numOutOfTree;
-	for (i=0; i<size; ++i)
+	if (ps->querySet == NULL)
 	{
-		tempArc = adjacencyList[sink-1].outOfTree[i];       
-		if (delta > 0)
-		{
-			printf ("c Error on sink-adjacent arc (%d, %d): capacity %.3f increases to %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity,
-				tempArc->capacity + delta);
-			exit(0);
-		}
-        printf ("c sink-adjacent arc (%d, %d): capacity %.3f increases   to %.3f.\n",
-				tempArc->from->number,
-				tempArc->to->number,
-				tempArc->capacity,
-				tempArc->capacity + delta);
-		tempArc->capacity += delta;
-		tempArc->flow += delta;
-		tempArc->from->excess -= delta;
-
-		if ((tempArc->from->label < numNodes) && (tempArc->from->excess > 0))
+		if ((ps->querySet = (int *) malloc (ps->numEdges * sizeof (int))) == NULL)
 		{
-			pushExcess (tempArc->from);
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
 		}
 	}
 
-	highestStrongLabel = (numNodes-1);
-}
-
-
-
+	memcpy (ps->querySet, ps->prevCutSet, size * sizeof (int));
+	ps->querySetSize = size;
 
-static double
-computeMinCut (void)
-{
-	int i;
-    double mincut = 0;
-
-	for (i=0; i<numArcs; ++i) 
+	if (edges)
 	{
-		
-        if ((arcList[i].from->label >= numNodes) && (arcList[i].to->label < numNodes))
-		{
-			
-            mincut += arcList[i].capacity;
-		}
+		memcpy (edges, ps->prevCutSet, size * sizeof (int));
 	}
-	return mincut;
-}
 
-static void
-pseudoflowPhase1 (void) 
-{
-	Node *strongRoot;
-	//int theparam = 0;
-	double thetime;
-    
-	thetime = timer ();
-    
-	while ((strongRoot = getHighestStrongRoot()))  
-	{ 
-		processRoot (strongRoot);
-	}
+	return size;
 }
 
-static void
-checkOptimality (void) 
+/* The sorted edge indices that entered or left the solution since the previous
+   c_getRatioEdgeList or c_getRatioEdgeDelta call (all of it on the first call).
+   changed must have room for numEdges entries. Returns the number of indices. */
+extern int c_getRatioEdgeDelta(ps_solver *ps, int *changed)
 {
-	int i, check = 1;
-	double mincut = 0, *excess;
-    double difference;
-
-	excess = (double *) malloc (numNodes * sizeof (double));
-	if (!excess)
-	{
-		printf ("%s Line %d: Out of memory\n", __FILE__, __LINE__);
-		exit (1);
-	}
-
-	for (i=0; i<numNodes; ++i)
-	{
-		excess[i] = 0;
-	}
+	int i = 0, j = 0, size = 0;
+	const int *old = ps->querySet, *cur = ps->prevCutSet;
+	const int oldSize = ps->querySetSize, curSize = ps->prevCutSetSize;
 
-	for (i=0; i<numArcs; ++i) 
+	while ((i < oldSize) || (j < curSize))
 	{
-		if ((arcList[i].from->label >= numNodes) && (arcList[i].to->label < numNodes))
+		if ((j == curSize) || ((i < oldSize) && (old[i] < cur[j])))
 		{
-			mincut += arcList[i].capacity;
+			changed[size++] = old[i++];
 		}
-
-		if ((arcList[i].flow > arcList[i].capacity) || (arcList[i].flow < 0)) 
+		else if ((i == oldSize) || (cur[j] < old[i]))
 		{
-			check = 0;
-			printf("c Capacity constraint violated on arc (%d, %d)\n", 
-				arcList[i].from->number,
-				arcList[i].to->number);
+			changed[size++] = cur[j++];
 		}
-		excess[arcList[i].from->number - 1] -= arcList[i].flow;
-		excess[arcList[i].to->number - 1] += arcList[i].flow;
-	}
-    
-    printf("c Mincut: %.3f\n", mincut);
-
-	for (i=0; i<numNodes; i++) 
-	{
-		if ((i != (source-1)) && (i != (sink-1))) 
+		else
 		{
-			if ((excess[i] > EPSILON) || (excess[i] < -EPSILON)) 
-			{
-				check = 0;
-				printf ("c Flow balance constraint violated in node %d. Excess = %.15f\n", 
-					i+1,
-					excess[i]);
-			}
+			++ i;
+			++ j;
 		}
 	}
 
-	if (check)
-	{
-		printf ("c\nc Solution checks as feasible.\n");
-	}
-
-	check = 1;
-    difference = excess[sink-1] - mincut;
-	if ((difference > EPSILON) || (difference < -EPSILON)) 
-	{
-		check = 0;
-		printf("c Flow is not optimal - max flow does not equal min cut! Difference: %.6f, %.6f\nc\n", excess[sink-1], mincut);
-	}
-
-	if (check) 
-	{
-		printf ("c\nc Solution checks as optimal.\nc \n");
-		printf ("s Max Flow            : %.3f\n", mincut);
-	}
-
-	free (excess);
-	excess = NULL;
-}
-
-
-static void
-quickSort (Arc **arr, const int first, const int last)
-{
-	int i, j, left=first, right=last, mid, pivot;
-    double x1, x2, x3, pivotval;
-	Arc *swap;
-
-	if ((right-left) <= 5)
-	{// Bubble sort if 5 elements or less
-		for (i=right; (i>left); --i)
-		{
-			swap = NULL;
-			for (j=left; j<i; ++j)
-			{
-				if (arr[j]->flow < arr[j+1]->flow)
-				{
-					swap = arr[j];
-					arr[j] = arr[j+1];
-					arr[j+1] = swap;
-				}
-			}
-
-			if (!swap)
-			{
-				return;
-			}
-		}
+	c_getRatioEdgeList (ps, NULL);
 
-		return;
-	}
-
-	mid = (first+last)/2;
+	return size;
+}
 
-	x1 = arr[first]->flow; 
-	x2 = arr[mid]->flow; 
-	x3 = arr[last]->flow;
+//---------------  Parametric cut ------------------
+/* Solves the min cut for a non-decreasing sequence of node costs lambdas[] at fixed
+   edge capacity c in one warm pseudoflow run: the node-vertex source arcs only grow,
+   so each step pushes the added excess and resumes phase 1. breakpoints[i] receives
+   the first lambda at which metagraph node i+1 leaves the source set, or INFINITY if
+   it never does; the exact breakpoint lies between that lambda and the one before it.
+   The source and the sink are not reported and get INFINITY as well. Returns 0, or -1
+   if lambdas[] is not monotone. */
+extern int c_parametricCut(ps_solver *ps, const double c, const double *lambdas, const int numLambdas,
+	double *breakpoints)
+{
+	int i;
 
-	pivot = mid;
-	
-	if (x1 <= x2)
+	for (i=1; i<numLambdas; ++i)
 	{
-		if (x2 > x3)
+		if (lambdas[i] < lambdas[i-1])
 		{
-			pivot = left;
-
-			if (x1 <= x3)
-			{
-				pivot = right;
-			}
+			printf ("c Error: parameter %d (%.6f) is smaller than parameter %d (%.6f).\n",
+				i, lambdas[i], i-1, lambdas[i-1]);
+			return -1;
 		}
 	}
-	else
-	{
-		if (x2 <= x3)
-		{
-			pivot = right;
 
-			if (x1 <= x3)
-			{
-				pivot = left;
-			}
-		}
+	if (numLambdas <= 0)
+	{
+		return 0;
 	}
 
-	pivotval = arr[pivot]->flow;
+	ps->numParams = numLambdas;
+	ps->theParam = 0;
 
-	swap = arr[first];
-	arr[first] = arr[pivot];
-	arr[pivot] = swap;
+	ps->highestStrongLabel = 1;
+	reCreateGraph (ps, ps->numEdges, lambdas[0], c);
+	simpleInitialization (ps);
+	pseudoflowPhase1 (ps);
 
-	left = (first+1);
+	for (ps->theParam=1; ps->theParam<numLambdas; ++ ps->theParam)
+	{
+		updateNodeCapacities (ps, lambdas[ps->theParam]);
+		pseudoflowPhase1 (ps);
+	}
 
-	while (left < right)
+	for (i=0; i<ps->numNodes; ++i)
 	{
-		if (arr[left]->flow < pivotval)
+		if (ps->coldList[ps->newIndex[i]].breakpoint)
 		{
-			swap = arr[left];
-			arr[left] = arr[right];
-			arr[right] = swap;
-			-- right;
+			breakpoints[i] = lambdas[ps->coldList[ps->newIndex[i]].breakpoint-1];
 		}
 		else
 		{
-			++ left;
+			breakpoints[i] = INFINITY;
 		}
 	}
 
-	swap = arr[first];
-	arr[first] = arr[left];
-	arr[left] = swap;
+	breakpoints[ps->source-1] = INFINITY;
+	breakpoints[ps->sink-1] = INFINITY;
 
-	if (first < (left-1))
-	{
-		quickSort (arr, first, (left-1));
-	}
-	
-	if ((left+1) < last)
-	{
-		quickSort (arr, (left+1), last);
-	}
+	// Later solves on this handle must not keep stamping breakpoints past the run.
+	ps->numParams = 0;
+	ps->theParam = 0;
+
+	return 0;
 }
 
-static void
-sort (Node * current)
+//---------------  Parallel lambda search ------------------
+typedef struct interval
 {
-	if (current->numOutOfTree > 1)
-	{
-		quickSort (current->outOfTree, 0, (current->numOutOfTree-1));
-	}
-}
+	double lower;
+	double upper;
+	double simLower;
+	double simUpper;
+	double denLower;
+	double denUpper;
+} Interval;
+
+typedef struct workQueue
+{
+	pthread_mutex_t lock;
+	Interval *items;
+	int head;
+	int tail;
+	int capacity;
+} WorkQueue;
+
+typedef struct lambdaSearch
+{
+	ps_solver **solvers;
+	WorkQueue *queues;
+	int numThreads;
+
+	int numEdges;
+	double totalSim;
+	double lambdaDelta;
+	double maxIters;
+	double precision;
+	double difference;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	int numQueued;
+	int numActive;
+	llint iterations;
+
+	pthread_mutex_t resultLock;
+	Solution *solutions;
+	int numSolutions;
+	int maxSolutions;
+} LambdaSearch;
+
+typedef struct lambdaWorker
+{
+	LambdaSearch *search;
+	int id;
+} LambdaWorker;
 
-static void
-minisort (Node *current) 
+extern ps_solver *ps_clone(const ps_solver *proto)
 {
-	Arc *temp = current->outOfTree[current->nextArc];
-	int i, size = current->numOutOfTree;
-    double tempflow = temp->flow;
+	ps_solver *ps = ps_create ();
 
-	for(i=current->nextArc+1; ((i<size) && (tempflow < current->outOfTree[i]->flow)); ++i)
-	{
-		current->outOfTree[i-1] = current->outOfTree[i];
-	}
-	current->outOfTree[i-1] = temp;
+	__sync_fetch_and_add (&proto->graph->refCount, 1);
+	attachTopology (ps, proto->graph);
+	ps->numEdges = proto->numEdges;
+	ps->numAuxiliary = proto->numAuxiliary;
+	ps->relabelFrequency = proto->relabelFrequency;
+	ps->capacityScale = proto->capacityScale;
+	ps->renumber = proto->renumber;
+
+	return ps;
 }
 
 static void
-decompose (Node *excessNode, const int source, int *iteration) 
+pushInterval (LambdaSearch *search, const int id, const Interval *item)
 {
-	Node *current = excessNode;
-	Arc *tempArc;
-	double bottleneck = excessNode->excess;
+	WorkQueue *queue = &search->queues[id];
 
-	for ( ;(current->number != source) && (current->visited < (*iteration)); 
-				current = tempArc->from)
-	{
-		current->visited = (*iteration);
-		tempArc = current->outOfTree[current->nextArc];
+	pthread_mutex_lock (&queue->lock);
 
-		if (tempArc->flow < bottleneck)
+	if (queue->tail == queue->capacity)
+	{
+		if (queue->head > 0)
 		{
-			bottleneck = tempArc->flow;
+			memmove (queue->items, &queue->items[queue->head], (queue->tail - queue->head) * sizeof (Interval));
+			queue->tail -= queue->head;
+			queue->head = 0;
 		}
-	}
-
-	if (current->number == source) 
-	{
-		excessNode->excess -= bottleneck;
-		current = excessNode;
-
-		while (current->number != source) 
+		else
 		{
-			tempArc = current->outOfTree[current->nextArc];
-			tempArc->flow -= bottleneck;
-
-			if (tempArc->flow) 
-			{
-				minisort(current);
-			}
-			else 
+			queue->capacity = queue->capacity ? 2*queue->capacity : 64;
+			if ((queue->items = (Interval *) realloc (queue->items, queue->capacity * sizeof (Interval))) == NULL)
 			{
-				++ current->nextArc;
+				printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+				exit (1);
 			}
-			current = tempArc->from;
 		}
-		return;
 	}
 
-	++ (*iteration);
+	queue->items[queue->tail] = (*item);
+	++ queue->tail;
+
+	pthread_mutex_unlock (&queue->lock);
+
+	pthread_mutex_lock (&search->lock);
+	++ search->numQueued;
+	pthread_cond_signal (&search->wakeup);
+	pthread_mutex_unlock (&search->lock);
+}
 
-	bottleneck = current->outOfTree[current->nextArc]->flow;
+/* The owner takes its newest interval, thieves take the oldest one. */
+static int
+popInterval (LambdaSearch *search, const int id, const int steal, Interval *item)
+{
+	WorkQueue *queue = &search->queues[id];
+	int found = 0;
+
+	pthread_mutex_lock (&queue->lock);
 
-	while (current->visited < (*iteration))
+	if (queue->head < queue->tail)
 	{
-		current->visited = (*iteration);
-		tempArc = current->outOfTree[current->nextArc];
+		if (steal)
+		{
+			(*item) = queue->items[queue->head];
+			++ queue->head;
+		}
+		else
+		{
+			-- queue->tail;
+			(*item) = queue->items[queue->tail];
+		}
 
-		if (tempArc->flow < bottleneck)
+		if (queue->head == queue->tail)
 		{
-			bottleneck = tempArc->flow;
+			queue->head = 0;
+			queue->tail = 0;
 		}
-		current = tempArc->from;
-	}	
-	
-	++ (*iteration);
+		found = 1;
+	}
 
-	while (current->visited < (*iteration))
-	{
-		current->visited = (*iteration);
+	pthread_mutex_unlock (&queue->lock);
 
-		tempArc = current->outOfTree[current->nextArc];
-		tempArc->flow -= bottleneck;
+	return found;
+}
 
-		if (tempArc->flow) 
+static void
+addSolution (LambdaSearch *search, const double lambda, const double sim, const double den,
+	const int *srcSet, const int size)
+{
+	Solution *sol;
+
+	pthread_mutex_lock (&search->resultLock);
+
+	if (search->numSolutions == search->maxSolutions)
+	{
+		search->maxSolutions = search->maxSolutions ? 2*search->maxSolutions : 16;
+		if ((search->solutions = (Solution *) realloc (search->solutions, search->maxSolutions * sizeof (Solution))) == NULL)
 		{
-			minisort(current);
-			current = tempArc->from;
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
 		}
-		else 
+	}
+
+	sol = &search->solutions[search->numSolutions];
+	++ search->numSolutions;
+
+	pthread_mutex_unlock (&search->resultLock);
+
+	sol->lambda = lambda;
+	sol->similarity = sim;
+	sol->density = den;
+	sol->size = size;
+	sol->edges = NULL;
+
+	if (size)
+	{
+		if ((sol->edges = (int *) malloc (size * sizeof (int))) == NULL)
 		{
-			++ current->nextArc;
-			current = tempArc->from;
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
 		}
+
+		memcpy (sol->edges, srcSet, size * sizeof (int));
 	}
 }
 
+static int
+distinctSolutions (const LambdaSearch *search, const double sim1, const double den1, const double sim2, const double den2)
+{
+	double dsim = (sim1 > sim2) ? (sim1 - sim2) : (sim2 - sim1);
+	double dden = (den1 > den2) ? (den1 - den2) : (den2 - den1);
+
+	return ((dsim > search->difference) || (dden > search->difference));
+}
+
 static void
-recoverFlow (void)
+processInterval (LambdaWorker *worker, const Interval *item)
 {
-	int i, j, iteration = 1;
-	Arc *tempArc;
-	Node *tempNode;
+	LambdaSearch *search = worker->search;
+	ps_solver *ps = search->solvers[worker->id];
+	Interval sub;
+	double middle = (item->lower + item->upper)/2, sim, den;
+	int distinctLower, distinctUpper;
 
-	for (i=0; i<adjacencyList[sink-1].numOutOfTree; ++i) 
+	solveRatio (ps, middle, search->totalSim, search->precision, 1000, &sim, &den);
+
+	distinctLower = distinctSolutions (search, sim, den, item->simLower, item->denLower);
+	if (distinctLower && ((middle - item->lower) > search->lambdaDelta))
 	{
-		
-        tempArc = adjacencyList[sink-1].outOfTree[i];
-                
-		if (tempArc->from->excess < 0) 
-		{
-			tempArc->flow -= (double) (-1*tempArc->from->excess);            
-			tempArc->from->excess = 0;
-		}        
+		sub.lower = item->lower;
+		sub.upper = middle;
+		sub.simLower = item->simLower;
+		sub.simUpper = sim;
+		sub.denLower = item->denLower;
+		sub.denUpper = den;
+		pushInterval (search, worker->id, &sub);
 	}
-    
-	for (i=0; i<adjacencyList[source-1].numOutOfTree; ++i) 
+
+	distinctUpper = distinctSolutions (search, sim, den, item->simUpper, item->denUpper);
+	if (distinctUpper && ((item->upper - middle) > search->lambdaDelta))
 	{
-		tempArc = adjacencyList[source-1].outOfTree[i];
-		addOutOfTreeNode (tempArc->to, tempArc);
+		sub.lower = middle;
+		sub.upper = item->upper;
+		sub.simLower = sim;
+		sub.simUpper = item->simUpper;
+		sub.denLower = den;
+		sub.denUpper = item->denUpper;
+		pushInterval (search, worker->id, &sub);
 	}
-    adjacencyList[source-1].excess = 0;
-	adjacencyList[sink-1].excess = 0;
-    
-	for (i=0; i<numNodes; ++i) 
+
+	if (distinctLower && distinctUpper)
+	{
+		addSolution (search, middle, sim, den, ps->prevCutSet, ps->prevCutSetSize);
+	}
+}
+
+static void *
+lambdaWorker (void *arg)
+{
+	LambdaWorker *worker = (LambdaWorker *) arg;
+	LambdaSearch *search = worker->search;
+	Interval item;
+	int i, found;
+
+	for (;;)
 	{
-		tempNode = &adjacencyList[i];
+		found = popInterval (search, worker->id, 0, &item);
 
-		if ((i == (source-1)) || (i == (sink-1)))
+		for (i=1; (!found) && (i<search->numThreads); ++i)
 		{
-			continue;
+			found = popInterval (search, (worker->id + i) % search->numThreads, 1, &item);
 		}
 
-		if (tempNode->label >= numNodes) 
+		pthread_mutex_lock (&search->lock);
+		if (found)
 		{
-			tempNode->nextArc = 0;            
-			if ((tempNode->parent) && (tempNode->arcToParent->flow))
-            //if ((tempNode->parent) && ((tempNode->arcToParent->flow > EPSILON) || (tempNode->arcToParent->flow < -EPSILON)))
+			-- search->numQueued;
+			if (search->iterations >= search->maxIters)
 			{
-				//printf ("c tempNode->arcToParent->flow: %.10f\n",  tempNode->arcToParent->flow);
-                addOutOfTreeNode (tempNode->arcToParent->to, tempNode->arcToParent);
+				found = 0;
 			}
-            //printf ("aaaa");
-			for (j=0; j<tempNode->numOutOfTree; ++j) 
+			else
 			{
-				if (!tempNode->outOfTree[j]->flow) 
-                //if ((tempNode->arcToParent->flow < EPSILON) && (tempNode->arcToParent->flow > -EPSILON)) 
-				{
-					-- tempNode->numOutOfTree;
-					tempNode->outOfTree[j] = tempNode->outOfTree[tempNode->numOutOfTree];
-					-- j;
-				}
+				++ search->numActive;
+				++ search->iterations;
+			}
+		}
+		else
+		{
+			while ((search->numQueued == 0) && (search->numActive > 0))
+			{
+				pthread_cond_wait (&search->wakeup, &search->lock);
 			}
 
-			sort(tempNode);
+			if ((search->numQueued == 0) && (search->numActive == 0))
+			{
+				pthread_cond_broadcast (&search->wakeup);
+				pthread_mutex_unlock (&search->lock);
+				break;
+			}
 		}
-	}
-    for (i=0; i<numNodes; ++i) 
-	{
-		tempNode = &adjacencyList[i];
-		while (tempNode->excess > EPSILON) 
+		pthread_mutex_unlock (&search->lock);
+
+		if (found)
 		{
-            ++ iteration;
-			decompose(tempNode, source, &iteration);
+			processInterval (worker, &item);
+
+			pthread_mutex_lock (&search->lock);
+			-- search->numActive;
+			if ((search->numActive == 0) && (search->numQueued == 0))
+			{
+				pthread_cond_broadcast (&search->wakeup);
+			}
+			pthread_mutex_unlock (&search->lock);
 		}
-	}    
+	}
+
+	return NULL;
 }
 
+static int
+compareSolutions (const void *a, const void *b)
+{
+	const Solution *s1 = (const Solution *) a, *s2 = (const Solution *) b;
 
+	return (s1->lambda > s2->lambda) - (s1->lambda < s2->lambda);
+}
 
-static void
-freeMemory (void)
+/* Bisects [l_min, l_max] like lambda_search in main.py, with one solver per thread
+   sharing the topology of ps. Returns the number of frontier solutions found. */
+extern int c_lambdaSearch(ps_solver *ps, const int num_edges, const double total_sim, const double l_min,
+	const double l_max, const double l_delta, const double max_iters, const int num_threads,
+	const double precision, const double difference, llint *iterations)
 {
+	LambdaSearch search;
+	LambdaWorker *workers;
+	pthread_t *threads;
+	Interval item;
+	double sim_l, den_l, sim_u, den_u;
 	int i;
 
-	for (i=0; i<numNodes; ++i)
+	memset (&search, 0, sizeof (LambdaSearch));
+	search.numThreads = (num_threads > 0) ? num_threads : 1;
+	search.numEdges = num_edges;
+	search.totalSim = total_sim;
+	search.lambdaDelta = l_delta;
+	search.maxIters = max_iters;
+	search.precision = precision;
+	search.difference = difference;
+
+	if (((search.solvers = (ps_solver **) malloc (search.numThreads * sizeof (ps_solver *))) == NULL) ||
+		((search.queues = (WorkQueue *) calloc (search.numThreads, sizeof (WorkQueue))) == NULL) ||
+		((workers = (LambdaWorker *) malloc (search.numThreads * sizeof (LambdaWorker))) == NULL) ||
+		((threads = (pthread_t *) malloc (search.numThreads * sizeof (pthread_t))) == NULL))
 	{
-		freeRoot (&strongRoots[i]);
+		printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+		exit (1);
 	}
 
-	free (strongRoots);
+	pthread_mutex_init (&search.lock, NULL);
+	pthread_cond_init (&search.wakeup, NULL);
+	pthread_mutex_init (&search.resultLock, NULL);
 
-	for (i=0; i<numNodes; ++i)
+	for (i=0; i<search.numThreads; ++i)
 	{
-		if (adjacencyList[i].outOfTree)
-		{
-			free (adjacencyList[i].outOfTree);
-		}
+		search.solvers[i] = ps_clone (ps);
+		pthread_mutex_init (&search.queues[i].lock, NULL);
+
+		workers[i].search = &search;
+		workers[i].id = i;
 	}
 
-	free (adjacencyList);
+	solveRatio (search.solvers[0], l_min, total_sim, precision, 1000, &sim_l, &den_l);
+	addSolution (&search, l_min, sim_l, den_l, search.solvers[0]->prevCutSet, search.solvers[0]->prevCutSetSize);
 
-	free (labelCount);
+	solveRatio (search.solvers[0], l_max, total_sim, precision, 1000, &sim_u, &den_u);
+	search.iterations = 2;
 
-	free (arcList);
-}
+	if (distinctSolutions (&search, sim_l, den_l, sim_u, den_u))
+	{
+		addSolution (&search, l_max, sim_u, den_u, search.solvers[0]->prevCutSet, search.solvers[0]->prevCutSetSize);
+
+		item.lower = l_min;
+		item.upper = l_max;
+		item.simLower = sim_l;
+		item.simUpper = sim_u;
+		item.denLower = den_l;
+		item.denUpper = den_u;
+		pushInterval (&search, 0, &item);
+	}
 
-extern void c_readDimacsFileCreateList(const char *filename)
-{
-    readDimacsFileCreateList(filename);
-}
-extern void c_simpleInitialization(){simpleInitialization();}
-extern void c_reInitialization(const double lambda, const double initial_guess, const int num_edges){reInitialization(lambda, initial_guess, num_edges);}
-extern void c_pseudoflowPhase1(){pseudoflowPhase1();}
-extern void c_recoverFlow(){recoverFlow();}
-extern void c_checkOptimality(){checkOptimality();}
-extern double c_getMinCutValue(){
-    double cutValue = computeMinCut();
-    return cutValue;
-}
+	for (i=0; i<search.numThreads; ++i)
+	{
+		pthread_create (&threads[i], NULL, lambdaWorker, &workers[i]);
+	}
 
-extern void c_getMinCutEdgeSet(const int num_edges, int *sourceSet)
-{
-    
-    int i = 0;
-    
-    for (i = 0; i < numNodes; ++i)
-    {
-        if (adjacencyList[i].number <= num_edges)
-        {
-            if (adjacencyList[i].label < numNodes)
-            {
-                sourceSet[adjacencyList[i].number-1] = 1;
-            }
-            else
-            {
-                sourceSet[adjacencyList[i].number-1] = 0;
-            }
-        }
-    }   
+	for (i=0; i<search.numThreads; ++i)
+	{
+		pthread_join (threads[i], NULL);
+	}
+
+	for (i=0; i<search.numThreads; ++i)
+	{
+		ps_destroy (search.solvers[i]);
+		pthread_mutex_destroy (&search.queues[i].lock);
+		free (search.queues[i].items);
+	}
+
+	pthread_mutex_destroy (&search.lock);
+	pthread_cond_destroy (&search.wakeup);
+	pthread_mutex_destroy (&search.resultLock);
+
+	free (search.solvers);
+	free (search.queues);
+	free (workers);
+	free (threads);
+
+	qsort (search.solutions, search.numSolutions, sizeof (Solution), compareSolutions);
+
+	freeFrontier (ps);
+	ps->frontier = search.solutions;
+	ps->numSolutions = search.numSolutions;
+
+	if (iterations)
+	{
+		(*iterations) = search.iterations;
+	}
+
+	return ps->numSolutions;
 }
 
-extern void c_getSizeOfMinCutSet(const int num_edges, int *F_edges, int *F_nodes)
+extern void c_getLambdaSolution(ps_solver *ps, const int i, double *lambda, double *sim, double *den, int *size)
 {
-    
-    int i;    
-    *F_edges = 0;
-    *F_nodes = 0;
-    for (i = 0; i < numNodes; ++i)
-    {
-        
-        if (adjacencyList[i].label < numNodes)
-        {
-            if (adjacencyList[i].number <= num_edges)
-            {
-                
-                (*F_edges)++;
-            }
-            else
-            {
-                
-                (*F_nodes)++;
-            }           
-        }
-    }
-    (*F_nodes)--;
-    
+	(*lambda) = ps->frontier[i].lambda;
+	(*sim) = ps->frontier[i].similarity;
+	(*den) = ps->frontier[i].density;
+	(*size) = ps->frontier[i].size;
 }
 
-extern void c_updateCapacities(const double capParameter){updateCapacities(capParameter);}
-extern void c_updateSinkCapacities(const double delta){updateSinkCapacities(delta);}
-extern void c_updateSrcCapacities(const double newcapacity, const int num_edges) { updateSrcCapacities(newcapacity, num_edges);}
+/* Solution i of the last c_lambdaSearch as a sorted list of edge indices. */
+extern int c_getLambdaSolutionEdgeList(ps_solver *ps, const int i, int *edges)
+{
+	memcpy (edges, ps->frontier[i].edges, ps->frontier[i].size * sizeof (int));
 
-extern void c_reCreateGraph(const int num_edges, const double lambda, const double c)
-{ 
-    freeMemory();
-    highestStrongLabel = 1;
-    reCreateGraph(num_edges, lambda, c); 
-    simpleInitialization();
+	return ps->frontier[i].size;
 }
 
-extern void c_finalfreeMemory()
+extern void c_getLambdaSolutionEdgeSet(ps_solver *ps, const int i, const int num_edges, int *sourceSet)
 {
-    freeMemory();
-    free(initEdgeList);
-}
+	int j;
 
-extern void c_freeMemory(){freeMemory();}
-extern void c_print_pars()
-{
-	printf ("c Number of nodes     : %d\n", numNodes);
-	printf ("c Number of arcs      : %d\n", numArcs);
-#ifdef STATS
-	printf ("c Number of arc scans : %lld\n", numArcScans);
-	printf ("c Number of mergers   : %d\n", numMergers);
-	printf ("c Number of pushes    : %lld\n", numPushes);
-	printf ("c Number of relabels  : %d\n", numRelabels);
-	printf ("c Number of gaps      : %d\n", numGaps);
-#endif
+	memset (sourceSet, 0, num_edges * sizeof (int));
+
+	for (j=0; j<ps->frontier[i].size; ++j)
+	{
+		sourceSet[ps->frontier[i].edges[j]] = 1;
+	}
 }
 
 int 
 main(int argc, char ** argv) 
 {    
+	ps_solver *ps = ps_create ();
+
 	printf ("c Pseudoflow algorithm for parametric min cut (version 1.0)\n");
-	readDimacsFileCreateList(argv[1]);
+	if ((strlen (argv[1]) > 4) && (!strcmp (argv[1] + strlen (argv[1]) - 4, ".bin")))
+	{
+		readBinaryFileCreateList (ps, argv[1]);
+	}
+	else
+	{
+		readDimacsFileCreateList (ps, argv[1]);
+	}
 
 #ifdef PROGRESS
 	printf ("c Finished reading file.\n"); fflush (stdout);
 #endif
 
-	simpleInitialization ();
+	simpleInitialization (ps);
 
 #ifdef PROGRESS
 	printf ("c Finished initialization.\n"); fflush (stdout);
 #endif
 
-	pseudoflowPhase1 ();
+	pseudoflowPhase1 (ps);
     
 
 #ifdef PROGRESS
@@ -1745,22 +4203,25 @@ main(int argc, char ** argv)
 #endif
 
 #ifdef RECOVER_FLOW
-	recoverFlow();
-	checkOptimality ();
+	recoverFlow (ps);
+	checkOptimality (ps);
 #endif
 
-	printf ("c Number of nodes     : %d\n", numNodes);
-	printf ("c Number of arcs      : %d\n", numArcs);
+	printf ("c Number of nodes     : %d\n", ps->numNodes);
+	printf ("c Number of arcs      : %lld\n", ps->numArcs);
 #ifdef STATS
-	printf ("c Number of arc scans : %lld\n", numArcScans);
-	printf ("c Number of mergers   : %d\n", numMergers);
-	printf ("c Number of pushes    : %lld\n", numPushes);
-	printf ("c Number of relabels  : %d\n", numRelabels);
-	printf ("c Number of gaps      : %d\n", numGaps);
+	printf ("c Number of arc scans : %lld\n", ps->numArcScans);
+	printf ("c Number of mergers   : %lld\n", ps->numMergers);
+	printf ("c Number of pushes    : %lld\n", ps->numPushes);
+	printf ("c Number of relabels  : %lld\n", ps->numRelabels);
+	printf ("c Number of gaps      : %lld\n", ps->numGaps);
+	printf ("c Number of detaches  : %lld\n", ps->numDetaches);
+	printf ("c Child walks saved   : %lld\n", ps->numWalksSaved);
+	printf ("c Global relabels     : %lld\n", ps->numGlobalRelabels);
 #endif
 
 
-	freeMemory ();
+	ps_destroy (ps);
 
 	return 0;
 }